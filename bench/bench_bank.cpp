@@ -0,0 +1,92 @@
+// Benchmark PidBank against a std::vector<PID> loop and check that every
+// lane matches PID::UpdateError + PID::TotalError.
+//
+//   ./bench_bank [controllers]
+//
+// Every controller gets its own gains around the pretuned set and its own
+// cte sequence, as in a population of twiddle probes.
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include "PID.h"
+#include "pid_bank.h"
+
+int main(int argc, char* argv[])
+{
+    size_t n = argc > 1 ? strtoul(argv[1], nullptr, 10) : 4096;
+    if (n == 0) n = 1;
+    const int steps = 200;
+
+    unsigned int seed = 3;
+    auto uniform = [&seed]() {
+        seed = seed * 1103515245 + 12345;
+        return (seed >> 8) / double(1 << 24);
+    };
+
+    std::vector<double> kp(n), ki(n), kd(n);
+    for (size_t k = 0; k < n; k++) {
+        kp[k] = 0.15 * (0.5 + uniform());
+        ki[k] = 0.001 * (0.5 + uniform());
+        kd[k] = 0.6 * (0.5 + uniform());
+    }
+    // steps x n cte values
+    std::vector<double> cte(steps * n);
+    for (int s = 0; s < steps; s++) {
+        for (size_t k = 0; k < n; k++) {
+            cte[s * n + k] = 0.8 * sin(s * 0.05 + k) + (uniform() - 0.5) * 0.05;
+        }
+    }
+
+    std::vector<double> ref(steps * n);
+    std::vector<PID> pids(n);
+    if (!isCacheAligned(pids.data())) {
+        std::printf("PID array not 64-byte aligned\n");
+        return 1;
+    }
+    for (size_t k = 0; k < n; k++) {
+        pids[k].Init(kp[k], ki[k], kd[k]);
+    }
+    auto t0 = std::chrono::steady_clock::now();
+    for (int s = 0; s < steps; s++) {
+        const double *c = &cte[s * n];
+        double *u = &ref[s * n];
+        for (size_t k = 0; k < n; k++) {
+            pids[k].UpdateError(c[k]);
+            u[k] = pids[k].TotalError();
+        }
+    }
+    auto t1 = std::chrono::steady_clock::now();
+    double vec_sec = std::chrono::duration<double>(t1 - t0).count();
+    std::printf("%zu controllers, %d steps\n", n, steps);
+    std::printf("%-16s %8.1f M controller-steps/sec\n", "vector<PID>", n * steps / vec_sec * 1e-6);
+
+    int failed = 0;
+    BANK_ISA best = PidBank::BestIsa();
+    for (int isa = BANK_SCALAR; isa <= best; isa++) {
+        PidBank bank(n);
+        bank.isa = static_cast<BANK_ISA>(isa);
+        for (size_t k = 0; k < n; k++) {
+            bank.Init(k, kp[k], ki[k], kd[k]);
+        }
+        std::vector<double> out(steps * n);
+        auto b0 = std::chrono::steady_clock::now();
+        for (int s = 0; s < steps; s++) {
+            bank.Step(&cte[s * n], &out[s * n]);
+        }
+        auto b1 = std::chrono::steady_clock::now();
+        double sec = std::chrono::duration<double>(b1 - b0).count();
+
+        size_t mismatch = 0;
+        double max_dev = 0;
+        for (size_t j = 0; j < out.size(); j++) {
+            if (out[j] != ref[j]) mismatch++;
+            max_dev = std::max(max_dev, fabs(out[j] - ref[j]));
+        }
+        std::printf("PidBank %-8s %8.1f M controller-steps/sec, %zu mismatches, max deviation %.3g\n",
+                    PidBank::IsaName(bank.isa), n * steps / sec * 1e-6, mismatch, max_dev);
+        if (max_dev > 1e-12) failed = 1;
+    }
+    return failed;
+}
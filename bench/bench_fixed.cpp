@@ -0,0 +1,105 @@
+// Benchmark the fixed-point controller against BasicPid<double>, for one
+// controller and for a bank of controllers stepped in a plain loop, and
+// print a checksum of the fixed-point outputs, which must be the same on
+// every machine and compiler.
+//
+//   ./bench_fixed [controllers]
+#include <chrono>
+#include <cinttypes>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include "fixed_pid.h"
+#include "pid_core.h"
+
+int main(int argc, char* argv[])
+{
+    size_t n = argc > 1 ? strtoul(argv[1], nullptr, 10) : 1024;
+    if (n == 0) n = 1;
+    const int steps = 512;
+    const int frac = FixedSteerPid::kFrac;
+
+    unsigned int seed = 5;
+    std::vector<double>  cte(steps);
+    std::vector<int32_t> cte_q(steps);
+    for (int s = 0; s < steps; s++) {
+        seed = seed * 1103515245 + 12345;
+        cte[s] = 0.8 * sin(s * 0.05) + ((seed >> 8) / double(1 << 24) - 0.5) * 0.05;
+        cte_q[s] = FixedSteerPid::ToFixed(cte[s], frac);
+    }
+
+    std::vector<BasicPid<double>> pid_d(n);
+    std::vector<FixedSteerPid>    pid_q(n);
+    for (size_t k = 0; k < n; k++) {
+        double scale = 0.5 + double(k) / n;
+        pid_d[k].Init(0.15 * scale, 0.001 * scale, 0.6 * scale);
+        pid_q[k].Init(0.15 * scale, 0.001 * scale, 0.6 * scale);
+    }
+
+    // one controller, latency bound
+    const int rounds = 2000;
+    volatile double  sink_d = 0;
+    volatile int64_t sink_q = 0;
+    auto t0 = std::chrono::steady_clock::now();
+    for (int r = 0; r < rounds; r++) {
+        double acc = 0;
+        for (int s = 0; s < steps; s++) {
+            pid_d[0].Update(cte[s]);
+            acc += pid_d[0].Output();
+        }
+        sink_d = acc;
+    }
+    auto t1 = std::chrono::steady_clock::now();
+    for (int r = 0; r < rounds; r++) {
+        int64_t acc = 0;
+        for (int s = 0; s < steps; s++) {
+            pid_q[0].Update(cte_q[s]);
+            acc += pid_q[0].Output();
+        }
+        sink_q = acc;
+    }
+    auto t2 = std::chrono::steady_clock::now();
+    double per = double(rounds) * steps;
+    std::printf("single   double %6.2f ns/step, fixed %6.2f ns/step\n",
+                std::chrono::duration<double, std::nano>(t1 - t0).count() / per,
+                std::chrono::duration<double, std::nano>(t2 - t1).count() / per);
+
+    // bank, throughput bound
+    for (size_t k = 0; k < n; k++) {
+        pid_d[k].Init(pid_d[k].Kp, pid_d[k].Ki, pid_d[k].Kd);
+        pid_q[k].p_error = pid_q[k].d_error = 0;
+        pid_q[k].i_error = 0;
+    }
+    uint64_t hash = 14695981039346656037ULL;
+    double max_dev = 0;
+    std::vector<double>  out_d(n);
+    std::vector<int32_t> out_q(n);
+    double bank_d = 0, bank_q = 0;
+    for (int s = 0; s < steps; s++) {
+        auto b0 = std::chrono::steady_clock::now();
+        for (size_t k = 0; k < n; k++) {
+            pid_d[k].Update(cte[s]);
+            out_d[k] = pid_d[k].Output();
+        }
+        auto b1 = std::chrono::steady_clock::now();
+        for (size_t k = 0; k < n; k++) {
+            pid_q[k].Update(cte_q[s]);
+            out_q[k] = pid_q[k].Output();
+        }
+        auto b2 = std::chrono::steady_clock::now();
+        bank_d += std::chrono::duration<double>(b1 - b0).count();
+        bank_q += std::chrono::duration<double>(b2 - b1).count();
+        for (size_t k = 0; k < n; k++) {
+            hash = (hash ^ static_cast<uint32_t>(out_q[k])) * 1099511628211ULL;
+            max_dev = std::max(max_dev, fabs(FixedSteerPid::ToDouble(out_q[k], frac) - out_d[k]));
+        }
+    }
+    double total = double(n) * steps;
+    std::printf("bank     double %6.1f M controller-steps/sec, fixed %6.1f M controller-steps/sec (%zu controllers)\n",
+                total / bank_d * 1e-6, total / bank_q * 1e-6, n);
+    std::printf("max deviation %.3g, fixed output checksum %016" PRIx64 "\n", max_dev, hash);
+    (void)sink_d;
+    (void)sink_q;
+    return max_dev < 1e-3 ? 0 : 1;
+}
@@ -0,0 +1,92 @@
+// Benchmark parseDouble() against std::stod and strtod on telemetry strings.
+//
+//   ./bench_parse [corpus.txt]
+//
+// The corpus holds one number per line, e.g. cte/speed/steering_angle values
+// cut from a recorded session. Without a file, a corpus in the simulator
+// format ("%.4f" for cte and speed, "%.4f" degrees for steering_angle) is
+// generated.
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "strconv.h"
+
+static std::vector<std::string> makeCorpus() {
+    std::vector<std::string> corpus;
+    unsigned int seed = 42;
+    char buf[32];
+    for (int i = 0; i < 3000; i++) {
+        seed = seed * 1103515245 + 12345;
+        double u = (seed >> 8) / double(1 << 24);
+        double v;
+        switch (i % 3) {
+            case 0:  v = (u - 0.5) * 6.0;  break;   // cte
+            case 1:  v = u * 45.0;         break;   // speed
+            default: v = (u - 0.5) * 50.0; break;   // steering_angle
+        }
+        snprintf(buf, sizeof(buf), "%.4f", v);
+        corpus.push_back(buf);
+    }
+    return corpus;
+}
+
+template <typename F>
+static double run(const char *name, const std::vector<std::string> &corpus, int rounds, F f) {
+    double sum = 0;
+    auto t0 = std::chrono::steady_clock::now();
+    for (int r = 0; r < rounds; r++) {
+        for (const auto &s : corpus) {
+            sum += f(s);
+        }
+    }
+    auto t1 = std::chrono::steady_clock::now();
+    double ns = std::chrono::duration<double, std::nano>(t1 - t0).count() / (double(rounds) * corpus.size());
+    std::printf("%-12s %8.2f ns/value  (checksum %.6f)\n", name, ns, sum);
+    return ns;
+}
+
+int main(int argc, char* argv[])
+{
+    std::vector<std::string> corpus;
+    if (argc > 1) {
+        std::ifstream in(argv[1]);
+        std::string line;
+        while (std::getline(in, line)) {
+            if (!line.empty()) corpus.push_back(line);
+        }
+    } else {
+        corpus = makeCorpus();
+    }
+    if (corpus.empty()) {
+        std::cerr << "[Error] empty corpus" << std::endl;
+        return 1;
+    }
+
+    // all three must agree bit for bit
+    size_t mismatch = 0;
+    for (const auto &s : corpus) {
+        double fast = 0;
+        PARSE_STATUS status = parseDouble(s.data(), s.data() + s.size(), fast);
+        double ref = strtod(s.c_str(), nullptr);
+        if (status != PARSE_OK || std::memcmp(&fast, &ref, sizeof(double)) != 0) {
+            std::cerr << "[Error] mismatch on \"" << s << "\"" << std::endl;
+            mismatch++;
+        }
+    }
+
+    const int rounds = 2000;
+    std::printf("%zu values x %d rounds\n", corpus.size(), rounds);
+    run("std::stod", corpus, rounds, [](const std::string &s) { return std::stod(s); });
+    run("strtod", corpus, rounds, [](const std::string &s) { return strtod(s.c_str(), nullptr); });
+    run("parseDouble", corpus, rounds, [](const std::string &s) {
+        double v = 0;
+        parseDouble(s.data(), s.data() + s.size(), v);
+        return v;
+    });
+    return mismatch ? 1 : 0;
+}
@@ -0,0 +1,163 @@
+// Benchmark the PID step (UpdateError + TotalError) for the precision and
+// gain policies of pid_core.h and check that they agree with PID.
+//
+//   ./bench_pid
+//
+// The cte sequence is a noisy sine, roughly what a lap of the lake track
+// looks like. "out-of-line" calls the same math through non-inlined
+// functions, the way PID::UpdateError / PID::TotalError were called before
+// they moved into the header. "scheduled" adds a gain schedule lookup by
+// speed and cte rate before every step.
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+#include "PID.h"
+#include "gain_schedule.h"
+#include "pid_core.h"
+
+__attribute__((noinline)) static void updateOutOfLine(BasicPid<double> &pid, double cte) {
+    pid.Update(cte);
+}
+
+__attribute__((noinline)) static double outputOutOfLine(const BasicPid<double> &pid) {
+    return pid.Output();
+}
+
+template <typename F>
+static double timeNs(int rounds, size_t n, F step) {
+    auto t0 = std::chrono::steady_clock::now();
+    for (int r = 0; r < rounds; r++) {
+        step();
+    }
+    auto t1 = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::nano>(t1 - t0).count() / (double(rounds) * n);
+}
+
+int main()
+{
+    std::vector<double> cte;
+    unsigned int seed = 11;
+    for (int i = 0; i < 4096; i++) {
+        seed = seed * 1103515245 + 12345;
+        double noise = ((seed >> 8) / double(1 << 24) - 0.5) * 0.05;
+        cte.push_back(0.8 * sin(i * 0.01) + noise);
+    }
+
+    // agreement with PID
+    PID pid;
+    pid.Init(0.15, 0.001, 0.6);
+    BasicPid<double> pid_d;
+    pid_d.Init(0.15, 0.001, 0.6);
+    BasicPid<float> pid_f;
+    pid_f.Init(0.15f, 0.001f, 0.6f);
+    PretunedPid pid_s;
+    pid_s.Init();
+    size_t mismatch = 0;
+    double max_float_dev = 0;
+    for (double c : cte) {
+        pid.UpdateError(c);
+        pid_d.Update(c);
+        pid_f.Update(static_cast<float>(c));
+        pid_s.Update(c);
+        double ref = pid.TotalError();
+        if (pid_d.Output() != ref || pid_s.Output() != ref) {
+            mismatch++;
+        }
+        max_float_dev = std::max(max_float_dev, fabs(pid_f.Output() - ref));
+    }
+    std::printf("%zu steps, %zu mismatches, float max deviation %.3g\n", cte.size(), mismatch, max_float_dev);
+
+    const int rounds = 2000;
+    const size_t n = cte.size();
+    volatile double sink = 0;
+    std::vector<float> cte_f(cte.begin(), cte.end());
+
+    double out_of_line = timeNs(rounds, n, [&] {
+        double acc = 0;
+        for (size_t i = 0; i < n; i++) {
+            updateOutOfLine(pid_d, cte[i]);
+            acc += outputOutOfLine(pid_d);
+        }
+        sink = acc;
+    });
+    double inline_d = timeNs(rounds, n, [&] {
+        double acc = 0;
+        for (size_t i = 0; i < n; i++) {
+            pid_d.Update(cte[i]);
+            acc += pid_d.Output();
+        }
+        sink = acc;
+    });
+    double inline_f = timeNs(rounds, n, [&] {
+        float acc = 0;
+        for (size_t i = 0; i < n; i++) {
+            pid_f.Update(cte_f[i]);
+            acc += pid_f.Output();
+        }
+        sink = acc;
+    });
+    double static_d = timeNs(rounds, n, [&] {
+        double acc = 0;
+        for (size_t i = 0; i < n; i++) {
+            pid_s.Update(cte[i]);
+            acc += pid_s.Output();
+        }
+        sink = acc;
+    });
+    BasicPid<double> pid_lp;
+    pid_lp.Init(0.15, 0.001, 0.6);
+    DerivFilter<double> d_filter;
+    d_filter.Set(DFILTER_BIQUAD, 0.1);
+    double filtered = timeNs(rounds, n, [&] {
+        double acc = 0;
+        for (size_t i = 0; i < n; i++) {
+            pid_lp.Update(cte[i], 1, d_filter);
+            acc += pid_lp.Output();
+        }
+        sink = acc;
+    });
+    // 8 speed bands, single rate band, gains rising with speed
+    GainSchedule schedule;
+    std::vector<float> bands;
+    for (int b = 0; b < 8; b++) {
+        bands.push_back(0.15f + 0.01f * b);
+        bands.push_back(0.001f);
+        bands.push_back(0.6f + 0.05f * b);
+    }
+    if (!schedule.SetSpeedBands(20, 5, bands)) {
+        return 1;
+    }
+    std::vector<double> speed(n);
+    for (size_t i = 0; i < n; i++) {
+        speed[i] = 30 + 10 * sin(i * 0.003);
+    }
+    double lookup = timeNs(rounds, n, [&] {
+        double acc = 0;
+        for (size_t i = 0; i < n; i++) {
+            double kp, ki, kd;
+            schedule.Lookup(speed[i], fabs(cte[i]), kp, ki, kd);
+            acc += kp + ki + kd;
+        }
+        sink = acc;
+    });
+    double scheduled = timeNs(rounds, n, [&] {
+        double acc = 0;
+        for (size_t i = 0; i < n; i++) {
+            schedule.Lookup(speed[i], fabs(cte[i] - pid_d.p_error), pid_d.Kp, pid_d.Ki, pid_d.Kd);
+            pid_d.Update(cte[i]);
+            acc += pid_d.Output();
+        }
+        sink = acc;
+    });
+    (void)sink;
+
+    std::printf("out-of-line       %6.2f ns/step\n", out_of_line);
+    std::printf("BasicPid<double>  %6.2f ns/step\n", inline_d);
+    std::printf("BasicPid<float>   %6.2f ns/step\n", inline_f);
+    std::printf("PretunedPid       %6.2f ns/step\n", static_d);
+    std::printf("biquad derivative %6.2f ns/step\n", filtered);
+    std::printf("schedule lookup   %6.2f ns/step\n", lookup);
+    std::printf("scheduled         %6.2f ns/step\n", scheduled);
+    return mismatch ? 1 : 0;
+}
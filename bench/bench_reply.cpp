@@ -0,0 +1,77 @@
+// Benchmark SteerMessage against the json::dump based steer reply and check
+// that both produce the same bytes.
+//
+//   ./bench_reply
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "json.hpp"
+#include "socketio.h"
+
+using json = nlohmann::json;
+
+static std::string jsonReply(double steer_value, double throttle_value) {
+    json msgJson;
+    msgJson["steering_angle"] = steer_value;
+    msgJson["throttle"] = throttle_value;
+    return "42[\"steer\"," + msgJson.dump() + "]";
+}
+
+int main()
+{
+    // steering from the controller and throttle from the d_angle law,
+    // plus a few edge cases
+    std::vector<double> steer;
+    std::vector<double> throttle;
+    unsigned int seed = 7;
+    for (int i = 0; i < 10000; i++) {
+        seed = seed * 1103515245 + 12345;
+        double u = (seed >> 8) / double(1 << 24);
+        steer.push_back((u - 0.5) * 2.4);
+        throttle.push_back(0.5 - 0.3 * fabs((u - 0.5) * 4.0));
+    }
+    const double edge[] = {0.0, -0.0, 1.0, -1.0, 0.5, 1e-5, -2.5e-7, 123456.0, 1e20, NAN, INFINITY};
+    for (double e : edge) {
+        steer.push_back(e);
+        throttle.push_back(e);
+    }
+
+    size_t mismatch = 0;
+    for (size_t i = 0; i < steer.size(); i++) {
+        SteerMessage msg;
+        msg.Set(steer[i], throttle[i]);
+        std::string ref = jsonReply(steer[i], throttle[i]);
+        if (ref != std::string(msg.data(), msg.length)) {
+            std::cerr << "[Error] mismatch: " << ref << " vs "
+                      << std::string(msg.data(), msg.length) << std::endl;
+            mismatch++;
+        }
+    }
+    std::printf("%zu replies, %zu mismatches\n", steer.size(), mismatch);
+
+    const int rounds = 100;
+    size_t bytes = 0;
+    auto t0 = std::chrono::steady_clock::now();
+    for (int r = 0; r < rounds; r++) {
+        for (size_t i = 0; i < steer.size(); i++) {
+            bytes += jsonReply(steer[i], throttle[i]).length();
+        }
+    }
+    auto t1 = std::chrono::steady_clock::now();
+    for (int r = 0; r < rounds; r++) {
+        for (size_t i = 0; i < steer.size(); i++) {
+            SteerMessage msg;
+            msg.Set(steer[i], throttle[i]);
+            bytes += msg.length;
+        }
+    }
+    auto t2 = std::chrono::steady_clock::now();
+
+    double n = double(rounds) * steer.size();
+    std::printf("json::dump   %8.2f ns/reply\n", std::chrono::duration<double, std::nano>(t1 - t0).count() / n);
+    std::printf("SteerMessage %8.2f ns/reply  (%zu bytes)\n", std::chrono::duration<double, std::nano>(t2 - t1).count() / n, bytes);
+    return mismatch ? 1 : 0;
+}
@@ -1,60 +1,135 @@
 #ifndef PID_H
 #define PID_H
 
-class PID {
+#include <cstdint>
+#include <type_traits>
+#include "pid_core.h"
+
+/*
+* Steering controller, only the state the control loop touches every step.
+* The error terms, gains and the per-step math come from BasicPid<double>
+* and fill the first cache line together with the two mode flags; the
+* derivative filter, read only when is_d_filter is set, fills the second.
+* UpdateError() and TotalError() are inline wrappers kept for the existing
+* callers, they run the derivative through d_filter when it is on and use
+* the velocity form with is_velocity. No virtual functions and trivially
+* copyable, so per connection copies and arrays of controllers are plain
+* memory. The twiddle search lives in TwiddleTuner, see twiddle.h.
+*/
+class alignas(64) PID : public BasicPid<double> {
 public:
-  bool      is_twiddle; 
-  bool      is_twiddle_init;
-  float     twiddle_tol;
-  int       twiddle_endstep;
-  int       twiddle_cnt;
-  float     twiddle_best_sse;
-  float     d_gain[3]; 
-  float     gain[3];        // current gain, convention Kp, Ki, Kd
-  float     best_gain[3];   // cached gain with best SSE
-  int       gain_idx;       // index to d_gain/gain, 0: P, 1: I, 2: D
-  int       state;
+  bool      is_velocity;    // incremental form, the output is kept in u instead of i_error
+  bool      is_d_filter;    // d_filter.IsOn(), set by SetDerivFilter()
+  DerivFilter<double> d_filter;   // optional derivative low-pass / derivative-on-measurement
 
   /*
-  * Errors
+  * Constructor, zero gains and errors, positional form without filter.
   */
-  double p_error;
-  double i_error;
-  double d_error;
+  PID();
 
   /*
-  * Coefficients
-  */ 
-  double Kp;
-  double Ki;
-  double Kd;
+  * Derivative low-pass of type t with the cutoff as a fraction of the
+  * update rate, and derivative-on-measurement, see DerivFilter.
+  */
+  void SetDerivFilter(DFILTER t, double cutoff, bool on_measurement) {
+    d_filter.Set(t, cutoff);
+    d_filter.on_measurement = on_measurement;
+    is_d_filter = d_filter.IsOn();
+  }
 
   /*
-  * Constructor
+  * Set the gains, clear the errors and the derivative filter state.
   */
-  PID();
+  void Init(double kp, double ki, double kd) {
+    BasicPid<double>::Init(kp, ki, kd);
+    d_filter.Reset();
+  }
 
   /*
-  * Destructor.
+  * Update the PID error variables given cross track error.
   */
-  virtual ~PID();
+  void UpdateError(double cte) {
+    if (is_velocity || is_d_filter) {
+      UpdateError(cte, 1);
+    } else {
+      Update(cte);
+    }
+  }
 
   /*
-  * Initialize PID.
+  * Same with the time since the last update relative to the tuning step,
+  * see clampedDtScale().
   */
-  void Init(double _Kp, double _Ki, double _Kd);
+  void UpdateError(double cte, double dt_scale) {
+    if (is_velocity) {
+      if (is_d_filter) {
+        UpdateVelocity(cte, dt_scale, d_filter);
+      } else {
+        UpdateVelocity(cte, dt_scale);
+      }
+    } else if (is_d_filter) {
+      Update(cte, dt_scale, d_filter);
+    } else {
+      Update(cte, dt_scale);
+    }
+  }
 
   /*
-  * Update the PID error variables given cross track error.
+  * BasicPid::UpdateLimited() through the derivative filter. The velocity
+  * form needs no anti-windup strategy: clamping u stops the integration
+  * at the limit.
   */
-  void UpdateError(double cte);
+  double UpdateLimited(double cte, double dt_scale, const PidLimits<double> &lim) {
+    if (is_velocity) {
+      UpdateError(cte, dt_scale);
+      u = std::min(std::max(u, lim.out_min), lim.out_max);
+      return u;
+    }
+    if (is_d_filter) {
+      return BasicPid<double>::UpdateLimited(cte, dt_scale, lim, d_filter);
+    }
+    return BasicPid<double>::UpdateLimited(cte, dt_scale, lim);
+  }
 
   /*
-  * Calculate the total PID error.
+  * Switch between the positional and the velocity form without a step in
+  * the output: u starts from the positional output, or i_error is set to
+  * the value that gives u.
   */
-  double TotalError();
+  void SetVelocity(bool on) {
+    if (on && !is_velocity) {
+      u = Output();
+    } else if (!on && is_velocity && Ki != 0) {
+      i_error = -(u + Kp * p_error + Kd * d_error) / Ki;
+    }
+    is_velocity = on;
+  }
 
-  int Twiddle(double SSE);
+  /*
+  * Drop the integral part of the output.
+  */
+  void ResetIntegral() {
+    i_error = 0;
+    if (is_velocity) {
+      u = Output();
+    }
+  }
+
+  /*
+  * Calculate the total PID error.
+  */
+  double TotalError() const { return is_velocity ? u : Output(); }
 };
 
+static_assert(std::is_trivially_copyable<PID>::value, "PID is copied as plain memory");
+static_assert(sizeof(PID) == 128, "PID hot state should take two cache lines");
+
+/*
+* Heap and container copies are only aligned with the aligned operator new,
+* -faligned-new before C++17, checked where controllers are created.
+*/
+inline bool isCacheAligned(const PID *pid) {
+  return (reinterpret_cast<uintptr_t>(pid) & 63) == 0;
+}
+
 #endif /* PID_H */
@@ -0,0 +1,114 @@
+#ifndef FIXED_PID_H
+#define FIXED_PID_H
+
+#include <cmath>
+#include <cstdint>
+#include <limits>
+
+/*
+* Saturating integer helpers for the fixed-point controller.
+*/
+inline int32_t saturate32(int64_t v) {
+  return static_cast<int32_t>(v < INT32_MIN ? INT32_MIN : (v > INT32_MAX ? INT32_MAX : v));
+}
+
+inline int64_t saturatingAdd64(int64_t a, int64_t b) {
+  int64_t r;
+  if (__builtin_add_overflow(a, b, &r)) {
+    return a > 0 ? INT64_MAX : INT64_MIN;
+  }
+  return r;
+}
+
+inline int64_t saturatingMul64(int64_t a, int64_t b) {
+  int64_t r;
+  if (__builtin_mul_overflow(a, b, &r)) {
+    return (a < 0) != (b < 0) ? INT64_MIN : INT64_MAX;
+  }
+  return r;
+}
+
+/*
+* Q-format fixed-point PID with PID::UpdateError / PID::TotalError
+* semantics and no floating point in the step, so results are bit exact
+* on any target. Errors and output are Q(FRAC) in 32 bits, gains are
+* Q(GAIN_FRAC) in 32 bits, the integral is Q(FRAC) in a 64-bit accumulator
+* saturated to I_BITS bits. Every operation saturates instead of wrapping.
+*
+* The defaults, Q15.16 errors and Q7.24 gains, cover cte up to +-32768 at
+* 1.5e-5 and gains up to +-128 at 6e-8.
+*/
+template <int FRAC = 16, int GAIN_FRAC = 24, int I_BITS = 40>
+struct FixedPid {
+  static_assert(FRAC > 0 && FRAC < 31, "FRAC must leave an integer part");
+  static_assert(GAIN_FRAC > 0 && GAIN_FRAC < 31, "GAIN_FRAC must leave an integer part");
+  static_assert(I_BITS >= 32 && I_BITS <= 63, "integral width is 32 to 63 bits");
+
+  static const int kFrac     = FRAC;
+  static const int kGainFrac = GAIN_FRAC;
+  static const int kIBits    = I_BITS;
+  static const int64_t kIntegralMax = (int64_t(1) << (I_BITS - 1)) - 1;
+
+  int32_t p_error;
+  int32_t d_error;
+  int64_t i_error;
+
+  int32_t Kp;
+  int32_t Ki;
+  int32_t Kd;
+
+  /*
+  * Round and saturate a real value to Q(frac), for setup and I/O only.
+  */
+  static int32_t ToFixed(double v, int frac) {
+    double q = std::round(std::ldexp(v, frac));
+    if (!(q > INT32_MIN)) return INT32_MIN;   // also nan
+    if (q > INT32_MAX) return INT32_MAX;
+    return static_cast<int32_t>(q);
+  }
+
+  static double ToDouble(int64_t q, int frac) {
+    return std::ldexp(static_cast<double>(q), -frac);
+  }
+
+  void Init(double kp, double ki, double kd) {
+    p_error = 0;
+    d_error = 0;
+    i_error = 0;
+    Kp = ToFixed(kp, GAIN_FRAC);
+    Ki = ToFixed(ki, GAIN_FRAC);
+    Kd = ToFixed(kd, GAIN_FRAC);
+  }
+
+  /*
+  * cte in Q(FRAC).
+  */
+  void Update(int32_t cte) {
+    d_error = saturate32(int64_t(cte) - p_error);
+    int64_t i = i_error + cte;   // no overflow, |i_error| < 2^62
+    i_error = i < -kIntegralMax ? -kIntegralMax : (i > kIntegralMax ? kIntegralMax : i);
+    p_error = cte;
+  }
+
+  /*
+  * (-Kp*p_error) + (-Kd*d_error) + (-Ki*i_error) in Q(FRAC), rounded.
+  */
+  int32_t Output() const {
+    // each 32x32 product is at most 2^62 in magnitude, their sum can reach 2^63
+    int64_t sum = saturatingAdd64(int64_t(Kp) * p_error, int64_t(Kd) * d_error);
+    sum = saturatingAdd64(sum, saturatingMul64(Ki, i_error));
+    int64_t rounded = saturatingAdd64(sum, int64_t(1) << (GAIN_FRAC - 1)) >> GAIN_FRAC;
+    return saturate32(-rounded);
+  }
+
+  double PError() const { return ToDouble(p_error, FRAC); }
+  double IError() const { return ToDouble(i_error, FRAC); }
+  double DError() const { return ToDouble(d_error, FRAC); }
+};
+
+/*
+* Steering controller with the default formats.
+*/
+typedef FixedPid<> FixedSteerPid;
+
+#endif /* FIXED_PID_H */
@@ -0,0 +1,76 @@
+// Dump a flight recorder ring file written by ./pid --record as CSV,
+// oldest record first, or with --frames as telemetry frames for ./pid_replay.
+// Those frames are rebuilt from the recorded values: cte, speed and
+// steering_angle only, as %.17g strings, and no frames other than
+// telemetry. A raw frame file written by ./pid --record_frames holds the
+// frames byte for byte as the simulator sent them and is printed as is.
+//
+//   ./pid_flightlog [--frames] <file>
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <sys/mman.h>
+#include "recorder.h"
+
+int main(int argc, char* argv[])
+{
+    bool frames = argc == 3 && std::strcmp(argv[1], "--frames") == 0;
+    if (argc != 2 && !frames) {
+        std::fprintf(stderr, "usage: %s [--frames] <file>\n", argv[0]);
+        return 1;
+    }
+    const char *path = argv[argc - 1];
+
+    size_t frame_map_size = 0;
+    const FrameHeader *frame_header = openFrameLog(path, frame_map_size);
+    if (frame_header != nullptr) {
+        const char *text = reinterpret_cast<const char *>(frame_header + 1);
+        std::fwrite(text, 1, frame_header->written.load(std::memory_order_acquire), stdout);
+        uint64_t dropped = frame_header->dropped.load(std::memory_order_relaxed);
+        if (dropped) {
+            std::fprintf(stderr, "[Warn] %" PRIu64 " frames did not fit in %s\n", dropped, path);
+        }
+        munmap(const_cast<FrameHeader *>(frame_header), frame_map_size);
+        return 0;
+    }
+
+    size_t map_size = 0;
+    const FlightHeader *header = openFlightLog(path, map_size);
+    if (header == nullptr) {
+        std::fprintf(stderr, "[Error] %s is not a flight recorder file\n", path);
+        return 1;
+    }
+    const FlightRecord *records = reinterpret_cast<const FlightRecord *>(header + 1);
+
+    uint64_t written = header->written.load(std::memory_order_acquire);
+    uint64_t first   = written > header->capacity ? written - header->capacity : 0;
+
+    if (frames) {
+        // %.17g keeps every value bit exact through the replay parser
+        for (uint64_t n = first; n < written; n++) {
+            const FlightRecord &r = records[n % header->capacity];
+            std::printf("42[\"telemetry\",{\"cte\":\"%.17g\",\"speed\":\"%.17g\",\"steering_angle\":\"%.17g\"}]\n",
+                        r.cte, r.speed, r.steering_angle);
+        }
+        munmap(const_cast<FlightHeader *>(header), map_size);
+        return 0;
+    }
+
+    std::printf("recv_ns,cte,speed,steering_angle,d_angle,p_error,i_error,d_error,"
+                "steer_value,throttle_value,twiddle_iter,step,"
+                "decode_ns,parse_ns,cost_ns,control_ns,reply_ns,send_ns\n");
+    for (uint64_t n = first; n < written; n++) {
+        const FlightRecord &r = records[n % header->capacity];
+        std::printf("%" PRIu64 ",%.6f,%.6f,%.6f,%.6f,%.6f,%.6f,%.6f,%.6f,%.6f,%d,%d",
+                    r.recv_ns, r.cte, r.speed, r.steering_angle, r.d_angle,
+                    r.p_error, r.i_error, r.d_error, r.steer_value, r.throttle_value,
+                    r.twiddle_iter, r.step);
+        for (int s = 0; s < STAGE_COUNT; s++) {
+            std::printf(",%u", r.stage_ns[s]);
+        }
+        std::printf("\n");
+    }
+
+    munmap(const_cast<FlightHeader *>(header), map_size);
+    return 0;
+}
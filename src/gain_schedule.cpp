@@ -0,0 +1,103 @@
+#include "gain_schedule.h"
+#include <cstdio>
+#include <cstring>
+
+static const char kMagic[8] = {'P', 'I', 'D', 'G', 'S', '0', '0', '1'};
+static const uint32_t kMaxBands = 1024;
+
+GainSchedule::GainSchedule() {
+    memset(&header, 0, sizeof(header));
+    speed_min      = 0;
+    rate_min       = 0;
+    inv_speed_step = 0;
+    inv_rate_step  = 0;
+    max_speed_band = 0;
+    max_rate_band  = 0;
+    row            = 0;
+    is_speed_only  = true;
+    table          = nullptr;
+}
+
+// Lay the packed n_speed x n_rate cells out in double with one extra row
+// and column that repeat the last ones, so the lookup never needs a bounds
+// check.
+void GainSchedule::Pad() {
+    uint32_t ns = header.n_speed;
+    uint32_t nr = header.n_rate;
+    uint32_t stride = nr + 1;
+    cells.assign(size_t(ns + 1) * stride * 4, 0.0);
+    for (uint32_t s = 0; s <= ns; s++) {
+        for (uint32_t r = 0; r <= nr; r++) {
+            const float *src = Cell(std::min(s, ns - 1), std::min(r, nr - 1));
+            std::copy(src, src + 4, &cells[(size_t(s) * stride + r) * 4]);
+        }
+    }
+    speed_min      = header.speed_min;
+    rate_min       = header.rate_min;
+    inv_speed_step = header.speed_step > 0 ? 1.0 / header.speed_step : 0;
+    inv_rate_step  = header.rate_step > 0 ? 1.0 / header.rate_step : 0;
+    max_speed_band = ns - 1;
+    max_rate_band  = nr - 1;
+    row            = stride * 4;
+    is_speed_only  = nr == 1;
+    table          = cells.data();
+}
+
+bool GainSchedule::SetSpeedBands(float speed_min, float speed_step, const std::vector<float> &gains) {
+    size_t n_speed = gains.size() / 3;
+    if (gains.size() < 3 || gains.size() % 3 != 0 || n_speed > kMaxBands ||
+        (n_speed > 1 && !(speed_step > 0))) {
+        return false;
+    }
+    memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.n_speed    = n_speed;
+    header.n_rate     = 1;
+    header.speed_min  = speed_min;
+    header.speed_step = speed_step;
+    header.rate_min   = 0;
+    header.rate_step  = 1;
+    packed.assign(header.n_speed * 4, 0.0f);
+    for (uint32_t b = 0; b < header.n_speed; b++) {
+        for (int j = 0; j < 3; j++) {
+            packed[b * 4 + j] = gains[b * 3 + j];
+        }
+    }
+    Pad();
+    return true;
+}
+
+bool GainSchedule::Load(const char *path) {
+    FILE *f = fopen(path, "rb");
+    if (f == nullptr) {
+        return false;
+    }
+    GainScheduleHeader h;
+    bool ok = fread(&h, sizeof(h), 1, f) == 1 && memcmp(h.magic, kMagic, sizeof(kMagic)) == 0 &&
+              h.n_speed > 0 && h.n_speed <= kMaxBands && h.n_rate > 0 && h.n_rate <= kMaxBands &&
+              (h.n_speed == 1 || h.speed_step > 0) && (h.n_rate == 1 || h.rate_step > 0);
+    std::vector<float> file_cells;
+    if (ok) {
+        file_cells.resize(size_t(h.n_speed) * h.n_rate * 4);
+        ok = fread(file_cells.data(), sizeof(float), file_cells.size(), f) == file_cells.size();
+    }
+    fclose(f);
+    if (!ok) {
+        return false;
+    }
+    header = h;
+    packed.swap(file_cells);
+    Pad();
+    return true;
+}
+
+bool GainSchedule::Save(const char *path) const {
+    FILE *f = fopen(path, "wb");
+    if (f == nullptr) {
+        return false;
+    }
+    bool ok = fwrite(&header, sizeof(header), 1, f) == 1;
+    for (uint32_t s = 0; ok && s < header.n_speed; s++) {
+        ok = fwrite(Cell(s, 0), sizeof(float), header.n_rate * 4, f) == header.n_rate * 4;
+    }
+    return fclose(f) == 0 && ok;
+}
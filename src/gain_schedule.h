@@ -0,0 +1,109 @@
+#ifndef GAIN_SCHEDULE_H
+#define GAIN_SCHEDULE_H
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+/*
+* Header of a gain schedule file, followed by n_speed * n_rate cells of
+* four floats (kp, ki, kd, unused), speed major. Little-endian, as written
+* by ./pid_tune --schedule_out.
+*/
+struct GainScheduleHeader {
+  char     magic[8];     // "PIDGS001"
+  uint32_t n_speed;
+  uint32_t n_rate;
+  float    speed_min;    // mph at the first speed band
+  float    speed_step;   // mph between bands
+  float    rate_min;     // |cte change| per step at the first rate band
+  float    rate_step;
+};
+
+/*
+* Steering gains scheduled on a uniform grid of operating points: speed and,
+* optionally, |cte| rate (change of cte since the last step). Lookup is a
+* bilinear interpolation between the four surrounding cells, clamped at the
+* edges, of the three gains only: one multiply per axis for the index, no
+* search, and a single-rate table skips the rate axis. The padded table is
+* kept in double so the control loop converts nothing. A table of a few
+* dozen cells stays in L1. Not copyable, table points into cells.
+*/
+class GainSchedule {
+public:
+  GainSchedule();
+
+  /*
+  * Single-rate table with the gains of each speed band, kp/ki/kd per band.
+  * False, leaving the table as it was, unless gains holds 1 to 1024 whole
+  * bands and the step is positive with more than one band.
+  */
+  bool SetSpeedBands(float speed_min, float speed_step, const std::vector<float> &gains);
+
+  bool Load(const char *path);
+  bool Save(const char *path) const;
+
+  uint32_t SpeedBands() const { return header.n_speed; }
+  uint32_t RateBands() const { return header.n_rate; }
+  const float *Cell(uint32_t speed_band, uint32_t rate_band) const {
+    return &packed[(size_t(speed_band) * header.n_rate + rate_band) * 4];
+  }
+
+  /*
+  * Interpolated gains at this operating point, inline for the control loop.
+  */
+  void Lookup(double speed, double cte_rate, double &kp, double &ki, double &kd) const {
+    // fractional band position clamped to the table, a nan input lands on 0
+    double s = std::min(max_speed_band, std::max(0.0, (speed - speed_min) * inv_speed_step));
+    int s0 = int(s);
+    double fs = s - s0;
+    // the row and column after the last one repeat it, so s0 + 1 and
+    // r0 + 1 are always inside the padded table
+    const double *c00 = table + s0 * row;
+    const double *c10 = c00 + row;
+    if (is_speed_only) {
+      kp = c00[0] + (c10[0] - c00[0]) * fs;
+      ki = c00[1] + (c10[1] - c00[1]) * fs;
+      kd = c00[2] + (c10[2] - c00[2]) * fs;
+      return;
+    }
+    double r = std::min(max_rate_band, std::max(0.0, (cte_rate - rate_min) * inv_rate_step));
+    int r0 = int(r);
+    double fr = r - r0;
+    c00 += r0 * 4;
+    c10 += r0 * 4;
+    const double *c01 = c00 + 4;
+    const double *c11 = c10 + 4;
+    double lo, hi;
+    lo = c00[0] + (c01[0] - c00[0]) * fr;
+    hi = c10[0] + (c11[0] - c10[0]) * fr;
+    kp = lo + (hi - lo) * fs;
+    lo = c00[1] + (c01[1] - c00[1]) * fr;
+    hi = c10[1] + (c11[1] - c10[1]) * fr;
+    ki = lo + (hi - lo) * fs;
+    lo = c00[2] + (c01[2] - c00[2]) * fr;
+    hi = c10[2] + (c11[2] - c10[2]) * fr;
+    kd = lo + (hi - lo) * fs;
+  }
+
+private:
+  GainScheduleHeader  header;
+  double              speed_min;        // header fields as double for the lookup
+  double              rate_min;
+  double              inv_speed_step;
+  double              inv_rate_step;
+  double              max_speed_band;   // n_speed - 1
+  double              max_rate_band;    // n_rate - 1
+  int                 row;              // doubles per padded speed row, (n_rate + 1) * 4
+  bool                is_speed_only;    // n_rate == 1, the rate axis is skipped
+  std::vector<float>  packed;           // n_speed x n_rate cells as in the file
+  std::vector<double> cells;            // (n_speed + 1) x (n_rate + 1) cells of kp, ki, kd, 0
+  const double       *table;            // cells.data()
+
+  GainSchedule(const GainSchedule &) = delete;
+  GainSchedule &operator=(const GainSchedule &) = delete;
+
+  void Pad();
+};
+
+#endif /* GAIN_SCHEDULE_H */
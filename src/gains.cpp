@@ -0,0 +1,128 @@
+#include "gains.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include "json.hpp"
+#include "logger.h"
+#include "strconv.h"
+
+// for convenience
+using json = nlohmann::json;
+
+// The published set. seq is odd while a publish is writing the fields and
+// 2 * version otherwise; the fields are relaxed atomics so a copy that
+// overlaps a publish is a detected retry, never a data race.
+struct GainSlot {
+  std::atomic<uint64_t> seq;
+  std::atomic<double>   kp;
+  std::atomic<double>   ki;
+  std::atomic<double>   kd;
+  std::atomic<bool>     reset_i;
+};
+
+static GainSlot   g_slot;
+
+// publishers only, the control loops never touch this
+static std::mutex g_publish_lock;
+
+uint64_t currentGainVersion() {
+    return g_slot.seq.load(std::memory_order_acquire) / 2;
+}
+
+bool latestGains(uint64_t applied, GainSet &gains) {
+    for (;;) {
+        uint64_t seq = g_slot.seq.load(std::memory_order_acquire);
+        if (seq / 2 == applied) {
+            return false;
+        }
+        if (seq & 1) {
+            continue;
+        }
+        gains.kp      = g_slot.kp.load(std::memory_order_relaxed);
+        gains.ki      = g_slot.ki.load(std::memory_order_relaxed);
+        gains.kd      = g_slot.kd.load(std::memory_order_relaxed);
+        gains.reset_i = g_slot.reset_i.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (g_slot.seq.load(std::memory_order_relaxed) == seq) {
+            gains.version = seq / 2;
+            return true;
+        }
+    }
+}
+
+uint64_t publishGains(double kp, double ki, double kd, bool reset_i) {
+    std::lock_guard<std::mutex> lock(g_publish_lock);
+    uint64_t seq = g_slot.seq.load(std::memory_order_relaxed);
+    g_slot.seq.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    g_slot.kp.store(kp, std::memory_order_relaxed);
+    g_slot.ki.store(ki, std::memory_order_relaxed);
+    g_slot.kd.store(kd, std::memory_order_relaxed);
+    g_slot.reset_i.store(reset_i, std::memory_order_relaxed);
+    g_slot.seq.store(seq + 2, std::memory_order_release);
+    uint64_t version = (seq + 2) / 2;
+
+    char msg[160];
+    int n = snprintf(msg, sizeof(msg), "[Info] Published gains v%llu kp: %g, ki: %g, kd: %g%s",
+                     static_cast<unsigned long long>(version), kp, ki, kd,
+                     reset_i ? ", reset i_error" : "");
+    PID_LOG(LOG_INFO, logText(LOG_INFO, msg, std::min<size_t>(n, sizeof(msg) - 1)));
+    return version;
+}
+
+static bool isTrue(const char *begin, const char *end) {
+    size_t n = end - begin;
+    return (n == 1 && *begin == '1') || (n == 4 && memcmp(begin, "true", 4) == 0);
+}
+
+bool parseGainQuery(const char *data, size_t length, GainRequest &req) {
+    const char *p   = data;
+    const char *end = data + length;
+    int found = 0;
+    req.reset_i = false;
+    while (p < end) {
+        const char *pair_end = static_cast<const char *>(memchr(p, '&', end - p));
+        if (pair_end == nullptr) pair_end = end;
+        const char *eq = static_cast<const char *>(memchr(p, '=', pair_end - p));
+        if (eq != nullptr) {
+            size_t key_len = eq - p;
+            double *target = nullptr;
+            int     bit    = 0;
+            if (key_len == 2 && memcmp(p, "kp", 2) == 0) { target = &req.kp; bit = 1; }
+            if (key_len == 2 && memcmp(p, "ki", 2) == 0) { target = &req.ki; bit = 2; }
+            if (key_len == 2 && memcmp(p, "kd", 2) == 0) { target = &req.kd; bit = 4; }
+            if (target != nullptr) {
+                if (parseDouble(eq + 1, pair_end, *target) != PARSE_OK || !std::isfinite(*target)) {
+                    return false;
+                }
+                found |= bit;
+            } else if (key_len == 7 && memcmp(p, "reset_i", 7) == 0) {
+                req.reset_i = isTrue(eq + 1, pair_end);
+            }
+        }
+        p = pair_end + 1;
+    }
+    return found == 7;
+}
+
+bool parseGainJson(const char *data, size_t length, GainRequest &req) {
+    try {
+        auto j = json::parse(std::string(data, length));
+        if (!j.is_object() || !j["kp"].is_number() || !j["ki"].is_number() || !j["kd"].is_number()) {
+            return false;
+        }
+        req.kp = j["kp"].get<double>();
+        req.ki = j["ki"].get<double>();
+        req.kd = j["kd"].get<double>();
+        auto reset_i = j.find("reset_i");
+        req.reset_i = reset_i != j.end() &&
+                      ((reset_i->is_boolean() && reset_i->get<bool>()) ||
+                       (reset_i->is_number() && reset_i->get<double>() != 0));
+    } catch (const std::exception &) {
+        return false;
+    }
+    return std::isfinite(req.kp) && std::isfinite(req.ki) && std::isfinite(req.kd);
+}
@@ -0,0 +1,55 @@
+#ifndef GAINS_H
+#define GAINS_H
+
+#include <cstddef>
+#include <cstdint>
+
+/*
+* Runtime gain hot-swap. The latest set lives in one fixed slot guarded by a
+* sequence counter (a seqlock): control loops compare its version with the
+* one they applied last at every step with a single atomic load, and copy a
+* new set out without a lock, retrying only if a publish overwrote it during
+* the copy. Publishing reuses the slot, so no matter how many sets clients
+* post the memory used stays the same.
+*/
+struct GainSet {
+  double   kp;
+  double   ki;
+  double   kd;
+  bool     reset_i;   // clear the integral term when switching to this set
+  uint64_t version;   // 1 for the first published set
+};
+
+/*
+* Version of the latest published set, 0 while the command line gains are
+* in use.
+*/
+uint64_t currentGainVersion();
+
+/*
+* Copy the latest published set to gains if its version differs from
+* applied, false if there is nothing newer.
+*/
+bool latestGains(uint64_t applied, GainSet &gains);
+
+/*
+* Publish a new set to every connection, returns its version.
+*/
+uint64_t publishGains(double kp, double ki, double kd, bool reset_i);
+
+/*
+* A gain change request, from "kp=..&ki=..&kd=..&reset_i=1" (query string or
+* form body) or from a set_gains event payload {"kp":..,"ki":..,"kd":..,
+* "reset_i":true}. All three gains are required.
+*/
+struct GainRequest {
+  double kp;
+  double ki;
+  double kd;
+  bool   reset_i;
+};
+
+bool parseGainQuery(const char *data, size_t length, GainRequest &req);
+bool parseGainJson(const char *data, size_t length, GainRequest &req);
+
+#endif /* GAINS_H */
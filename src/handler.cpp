@@ -0,0 +1,242 @@
+#include "handler.h"
+#include <math.h>
+#include <string>
+#include "gains.h"
+#include "json.hpp"
+#include "latency.h"
+#include "logger.h"
+#include "socketio.h"
+#include "telemetry.h"
+
+// for convenience
+using json = nlohmann::json;
+
+Handler::Handler() {
+    step             = 0;
+    SSE              = 0;
+    previous_angle   = 0;
+    is_validate_json = false;
+    gain_version     = 0;
+    dt_ref           = 0;
+    dt_clamp         = 4;
+    last_recv_ns     = 0;
+    is_limited       = false;
+    is_speed_control = false;
+    schedule         = nullptr;
+    recorder         = nullptr;
+    frame_recorder   = nullptr;
+    for (int s = 0; s < STAGE_COUNT; s++) {
+        stage_ns[s] = 0;
+    }
+}
+
+HANDLE_RESULT Handler::OnMessage(const char *data, size_t length, MessageSink &sink) {
+    uint64_t stage_t[STAGE_COUNT + 1]; // timestamp at start of each stage and at the end
+    stage_t[STAGE_DECODE] = nowNs();
+    step++;
+    SessionStats *st = stats.get();
+    if (st != nullptr) {
+        statInc(st->frames);
+    }
+    if (frame_recorder != nullptr) {
+        frame_recorder->Write(data, length);
+    }
+    // "42" at the start of the message means there's a websocket message event.
+    // The 4 signifies a websocket message
+    // The 2 signifies a websocket event
+    if (!(length && length > 2 && data[0] == '4' && data[1] == '2')) {
+        if (st != nullptr) statInc(st->dropped);
+        return HANDLE_IGNORED;
+    }
+
+    SioFrame frame;
+    if (!decodeFrame(data, length, frame)) {
+        // Manual driving
+        static const char msg[] = "42[\"manual\",{}]";
+        sink.Send(msg, sizeof(msg) - 1);
+        if (st != nullptr) statInc(st->manual);
+        return HANDLE_MANUAL;
+    }
+
+    stage_t[STAGE_PARSE] = nowNs();
+    // fast path for telemetry, anything else goes through the json DOM
+    Telemetry tel;
+    bool is_telemetry = extractTelemetry(frame, tel);
+    if (!is_telemetry) {
+        if (frame.event.equals("set_gains")) {
+            GainRequest req;
+            if (!parseGainJson(frame.payload.data, frame.payload.length, req)) {
+                static const char err[] = "[Error] Invalid set_gains, expected {\"kp\":..,\"ki\":..,\"kd\":..}";
+                PID_LOG(LOG_ERROR, logText(LOG_ERROR, err, sizeof(err) - 1));
+                if (st != nullptr) statInc(st->dropped);
+                return HANDLE_IGNORED;
+            }
+            publishGains(req.kp, req.ki, req.kd, req.reset_i);
+            return HANDLE_CONTROL;
+        }
+        is_telemetry = parseTelemetryJson(frame, tel);
+    } else if (is_validate_json) {
+        Telemetry ref;
+        if (!parseTelemetryJson(frame, ref) || ref.cte != tel.cte ||
+            ref.speed != tel.speed || ref.steering_angle != tel.steering_angle) {
+            std::string err = "[Error] Telemetry extractor mismatch: " +
+                              std::string(frame.json.data, frame.json.length);
+            PID_LOG(LOG_ERROR, logText(LOG_ERROR, err.data(), err.length()));
+        }
+    }
+    if (!is_telemetry) {
+        if (st != nullptr) statInc(st->dropped);
+        return HANDLE_IGNORED;
+    }
+
+    stage_t[STAGE_COST] = nowNs();
+    double cte = tel.cte;
+    double speed = tel.speed;
+    double angle = tel.steering_angle;
+    double steer_value;
+    double throttle_value;
+
+    double d_angle;
+    d_angle = previous_angle - angle;
+    previous_angle = angle;
+
+    if (!tuner.IsEnabled()) {
+        PID_LOG(LOG_INFO, logTelemetry(cte, speed, angle, d_angle));
+    }
+    // Sum of square error - cost function for twiddle
+    SSE += cte*cte;               // minimize the car gap to the reference line
+    SSE += angle*angle;           // penalize large angle so that car takes small angle overall
+    // reference speed is 40, or the target of the speed controller, ensure car
+    // is moving, also as close to reference speed
+    double ref_speed = is_speed_control ? speed_control.target_speed : 40;
+    SSE += pow((ref_speed - speed),2);
+
+    if (tuner.IsEnabled()) {
+        // Triggle twiddle loop when number of step reaching threshold or
+        // when accumulated SSE is already over best SSE
+        if ((step > tuner.EndStep()) || (SSE > tuner.BestSse())) {
+            PID_LOG(LOG_INFO, logText(LOG_INFO, "", 0));
+            static const char reset_msg[] = "42[\"reset\",{}]";
+            sink.Send(reset_msg, sizeof(reset_msg) - 1);
+
+            // Call to twiddle loop - 1 to terminate, 0 continue twiddle tuning
+            if (tuner.Twiddle(SSE, pid_steer)) return HANDLE_TWIDDLE_DONE;
+
+            // reset step count and SSE accumulator
+            step = 0;
+            SSE = 0;
+            speed_control.Reset();
+        }
+
+        //Print out during tuning operation
+        if (LOG_INFO >= PID_LOG_LEVEL && logEnabled(LOG_INFO)) {
+            TwiddleProgress tp = tuner.Progress();
+            logTwiddle(tp.iteration/3, step, tp.gain_idx, tp.state,
+                       pid_steer.Kp, pid_steer.Ki, pid_steer.Kd,
+                       tp.d_gain[0], tp.d_gain[1], tp.d_gain[2],
+                       tp.best_sse, SSE);
+        }
+    }
+
+    stage_t[STAGE_CONTROL] = nowNs();
+    // pick up gains published since the last step, twiddle owns them while tuning
+    GainSet gains;
+    if (!tuner.IsEnabled() && latestGains(gain_version, gains)) {
+        pid_steer.Kp = gains.kp;
+        pid_steer.Ki = gains.ki;
+        pid_steer.Kd = gains.kd;
+        if (gains.reset_i) {
+            pid_steer.ResetIntegral();
+        }
+        gain_version = gains.version;
+    }
+    // scheduled gains for the current speed and cte rate
+    if (schedule != nullptr) {
+        schedule->Lookup(speed, fabs(cte - pid_steer.p_error), pid_steer.Kp, pid_steer.Ki, pid_steer.Kd);
+    }
+    // with dt_ref the i and d terms follow the real time between frames, the
+    // receive timestamp is the one already taken for the stage timings
+    double dt_scale = 1;
+    if (dt_ref > 0 && last_recv_ns != 0) {
+        double dt = (stage_t[STAGE_DECODE] - last_recv_ns) * 1e-9;
+        dt_scale = clampedDtScale(dt, dt_ref, dt_clamp);
+    }
+    if (is_limited) {
+        steer_value = pid_steer.UpdateLimited(cte, dt_scale, limits);
+    } else {
+        if (dt_ref > 0) {
+            pid_steer.UpdateError(cte, dt_scale);
+        } else {
+            pid_steer.UpdateError(cte); // call to update p, i, d error term corresponding to cte
+        }
+        steer_value = pid_steer.TotalError(); // call to calculate (-Kp*p_error) + (-Kd*d_error) + (-Ki*i_error)
+    }
+    last_recv_ns = stage_t[STAGE_DECODE];
+
+    if (is_speed_control) {
+        // speed PID on a setpoint that drops with this step's steering demand
+        throttle_value = speed_control.Throttle(speed, steer_value);
+    } else {
+        /* throttle is reduced proportionally to the change of steering angle
+         * the idea is when change of steering angle is large, it signifies a huge turn
+         * hence we need to slow down or brake */
+        throttle_value = 0.5 - 0.3 * fabs(d_angle);
+    }
+
+    PID_LOG(LOG_INFO, logActuation(throttle_value, steer_value));
+
+    stage_t[STAGE_REPLY] = nowNs();
+    SteerMessage msg;
+    msg.Set(steer_value, throttle_value);
+    if (is_validate_json) {
+        json msgJson;
+        msgJson["steering_angle"] = steer_value;
+        msgJson["throttle"] = throttle_value;
+        auto ref = "42[\"steer\"," + msgJson.dump() + "]";
+        if (ref != std::string(msg.data(), msg.length)) {
+            std::string err = "[Error] Steer message mismatch: " + ref;
+            PID_LOG(LOG_ERROR, logText(LOG_ERROR, err.data(), err.length()));
+        }
+    }
+
+    stage_t[STAGE_SEND] = nowNs();
+    sink.Send(msg.data(), msg.length);
+    stage_t[STAGE_COUNT] = nowNs();
+
+    for (int s = 0; s < STAGE_COUNT; s++) {
+        stage_ns[s] = stage_t[s + 1] - stage_t[s];
+    }
+    recordStageLatency(stage_ns);
+
+    if (st != nullptr) {
+        statInc(st->telemetry);
+        st->gain[0].store(pid_steer.Kp, std::memory_order_relaxed);
+        st->gain[1].store(pid_steer.Ki, std::memory_order_relaxed);
+        st->gain[2].store(pid_steer.Kd, std::memory_order_relaxed);
+        st->gain_version.store(gain_version, std::memory_order_relaxed);
+        st->twiddle_iter.store(tuner.Iteration(), std::memory_order_relaxed);
+        st->best_sse.store(tuner.BestSse(), std::memory_order_relaxed);
+        st->sse.store(SSE, std::memory_order_relaxed);
+    }
+
+    if (recorder != nullptr && recorder->IsOpen()) {
+        FlightRecord rec;
+        rec.recv_ns        = stage_t[STAGE_DECODE];
+        rec.cte            = cte;
+        rec.speed          = speed;
+        rec.steering_angle = angle;
+        rec.d_angle        = d_angle;
+        rec.p_error        = pid_steer.p_error;
+        rec.i_error        = pid_steer.i_error;
+        rec.d_error        = pid_steer.d_error;
+        rec.steer_value    = steer_value;
+        rec.throttle_value = throttle_value;
+        rec.twiddle_iter   = tuner.Iteration();
+        rec.step           = step;
+        for (int s = 0; s < STAGE_COUNT; s++) {
+            rec.stage_ns[s] = stage_ns[s];
+        }
+        recorder->Write(rec);
+    }
+    return HANDLE_TELEMETRY;
+}
@@ -0,0 +1,68 @@
+#ifndef HANDLER_H
+#define HANDLER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include "PID.h"
+#include "gain_schedule.h"
+#include "metrics.h"
+#include "recorder.h"
+#include "speed_control.h"
+#include "timing.h"
+#include "twiddle.h"
+
+/*
+* Destination of the replies produced for a frame, a websocket in ./pid and
+* a checksum in ./pid_replay.
+*/
+class MessageSink {
+public:
+  virtual ~MessageSink() {}
+  virtual void Send(const char *data, size_t length) = 0;
+};
+
+enum HANDLE_RESULT
+{
+    HANDLE_IGNORED = 0,   // not a SocketIO event or not telemetry
+    HANDLE_MANUAL,        // no data, manual driving
+    HANDLE_TELEMETRY,     // telemetry handled, steer sent
+    HANDLE_TWIDDLE_DONE,  // twiddle tuning complete, caller should exit
+    HANDLE_CONTROL        // set_gains event, new gains published
+};
+
+/*
+* Everything the simulator message handler does for one received frame:
+* decode, parse, cost accumulation, twiddle, PID update and reply.
+*/
+class Handler {
+public:
+  PID             pid_steer;
+  TwiddleTuner    tuner;                    // online twiddle of pid_steer, cold
+  int             step;
+  float           SSE;                      // sum of square error for twiddle
+  double          previous_angle;
+  bool            is_validate_json;
+  uint64_t        gain_version;             // version of the published gain set in use, 0: command line
+  double          dt_ref;                   // s, frame interval the gains are tuned at, 0: fixed step
+  double          dt_clamp;                 // frame intervals are limited to [dt_ref/clamp, dt_ref*clamp]
+  uint64_t        last_recv_ns;             // receive time of the previous telemetry frame
+  bool            is_limited;               // steering output limits and anti-windup enabled
+  PidLimits<double> limits;
+  const GainSchedule *schedule;             // optional steering gains by operating point, not owned
+  bool            is_speed_control;         // throttle from speed_control instead of the d_angle law
+  SpeedControl    speed_control;
+  FlightRecorder *recorder;                 // optional, not owned
+  FrameRecorder  *frame_recorder;           // optional raw frames for pid_replay, not owned
+  std::shared_ptr<SessionStats> stats;      // optional, counters for /metrics and /stats
+  uint32_t        stage_ns[STAGE_COUNT];    // stage latencies of the last telemetry step
+
+  Handler();
+
+  /*
+  * Handle one raw SocketIO frame, replies are passed to sink.
+  */
+  HANDLE_RESULT OnMessage(const char *data, size_t length, MessageSink &sink);
+};
+
+#endif /* HANDLER_H */
@@ -0,0 +1,116 @@
+#include "latency.h"
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <string>
+
+const char *kStageName[STAGE_COUNT] = {
+    "decode", "parse", "cost", "control", "reply", "send"
+};
+
+LatencyHistogram::LatencyHistogram() {
+    for (int b = 0; b < kBuckets; b++) {
+        counts[b].store(0, std::memory_order_relaxed);
+    }
+    sum.store(0, std::memory_order_relaxed);
+    max.store(0, std::memory_order_relaxed);
+}
+
+uint64_t LatencyHistogram::BucketValue(int b) {
+    if (b < 64) {
+        return b;
+    }
+    int e   = 6 + (b - 64) / 32;
+    int sub = (b - 64) % 32;
+    return ((uint64_t(32 + sub + 1)) << (e - 5)) - 1;
+}
+
+HistogramSnapshot::HistogramSnapshot() {
+    for (int b = 0; b < LatencyHistogram::kBuckets; b++) {
+        counts[b] = 0;
+    }
+    total = 0;
+    sum   = 0;
+    max   = 0;
+}
+
+void HistogramSnapshot::Add(const LatencyHistogram &h) {
+    for (int b = 0; b < LatencyHistogram::kBuckets; b++) {
+        uint64_t c = h.counts[b].load(std::memory_order_relaxed);
+        counts[b] += c;
+        total     += c;
+    }
+    sum += h.sum.load(std::memory_order_relaxed);
+    uint64_t m = h.max.load(std::memory_order_relaxed);
+    if (m > max) max = m;
+}
+
+uint64_t HistogramSnapshot::Percentile(double q) const {
+    if (total == 0) {
+        return 0;
+    }
+    uint64_t rank = static_cast<uint64_t>(q * total);
+    if (rank >= total) rank = total - 1;
+    uint64_t seen = 0;
+    for (int b = 0; b < LatencyHistogram::kBuckets; b++) {
+        seen += counts[b];
+        if (seen > rank) {
+            uint64_t v = LatencyHistogram::BucketValue(b);
+            return v < max ? v : max;
+        }
+    }
+    return max;
+}
+
+struct StageShard {
+  LatencyHistogram stage[STAGE_COUNT];
+  StageShard      *next;
+};
+
+static std::atomic<StageShard *> g_shards(nullptr);
+static thread_local StageShard  *t_shard = nullptr;
+
+void recordStageLatency(const uint32_t stage_ns[STAGE_COUNT]) {
+    if (t_shard == nullptr) {
+        void *mem = nullptr;
+        if (posix_memalign(&mem, 64, sizeof(StageShard)) != 0) {
+            return;
+        }
+        StageShard *shard = new (mem) StageShard();
+        shard->next = g_shards.load(std::memory_order_relaxed);
+        while (!g_shards.compare_exchange_weak(shard->next, shard, std::memory_order_release)) {}
+        t_shard = shard;
+    }
+    for (int s = 0; s < STAGE_COUNT; s++) {
+        t_shard->stage[s].Record(stage_ns[s]);
+    }
+}
+
+void snapshotStageLatency(HistogramSnapshot snapshot[STAGE_COUNT]) {
+    for (StageShard *shard = g_shards.load(std::memory_order_acquire); shard; shard = shard->next) {
+        for (int s = 0; s < STAGE_COUNT; s++) {
+            snapshot[s].Add(shard->stage[s]);
+        }
+    }
+}
+
+void dumpStageLatency(std::ostream &o) {
+    HistogramSnapshot snapshot[STAGE_COUNT];
+    snapshotStageLatency(snapshot);
+
+    // built up front so it reaches the stream in one piece
+    std::string out;
+    char line[128];
+    snprintf(line, sizeof(line), "%-8s %10s %8s %8s %8s %8s  (ns)\n",
+             "stage", "count", "p50", "p99", "p99.9", "max");
+    out += line;
+    for (int s = 0; s < STAGE_COUNT; s++) {
+        const HistogramSnapshot &h = snapshot[s];
+        snprintf(line, sizeof(line), "%-8s %10" PRIu64 " %8" PRIu64 " %8" PRIu64 " %8" PRIu64 " %8" PRIu64 "\n",
+                 kStageName[s], h.total, h.Percentile(0.50), h.Percentile(0.99),
+                 h.Percentile(0.999), h.max);
+        out += line;
+    }
+    o << out << std::flush;
+}
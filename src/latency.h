@@ -0,0 +1,83 @@
+#ifndef LATENCY_H
+#define LATENCY_H
+
+#include <atomic>
+#include <cstdint>
+#include <ostream>
+#include "timing.h"
+
+/*
+* HDR-style log-linear latency histogram in nanoseconds: exact below 64 ns,
+* then 32 buckets per power of two (about 3% resolution) up to ~4 s.
+* Single writer, any number of readers; the writer only does relaxed loads
+* and stores, so recording costs no locked instruction.
+*/
+class LatencyHistogram {
+public:
+  static const int kBuckets = 64 + 26 * 32;
+
+  LatencyHistogram();
+
+  void Record(uint64_t ns) {
+    int b = Bucket(ns);
+    counts[b].store(counts[b].load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    sum.store(sum.load(std::memory_order_relaxed) + ns, std::memory_order_relaxed);
+    if (ns > max.load(std::memory_order_relaxed)) {
+      max.store(ns, std::memory_order_relaxed);
+    }
+  }
+
+  static int Bucket(uint64_t ns) {
+    if (ns < 64) {
+      return static_cast<int>(ns);
+    }
+    int e = 63 - __builtin_clzll(ns);   // >= 6
+    if (e > 31) {
+      return kBuckets - 1;
+    }
+    return 64 + (e - 6) * 32 + static_cast<int>((ns >> (e - 5)) - 32);
+  }
+
+  /*
+  * Highest value that falls into bucket b.
+  */
+  static uint64_t BucketValue(int b);
+
+  std::atomic<uint64_t> counts[kBuckets];
+  std::atomic<uint64_t> sum;   // exact total of the recorded ns
+  std::atomic<uint64_t> max;
+};
+
+/*
+* Merged copy of one or more histograms, for reporting.
+*/
+struct HistogramSnapshot {
+  uint64_t counts[LatencyHistogram::kBuckets];
+  uint64_t total;
+  uint64_t sum;
+  uint64_t max;
+
+  HistogramSnapshot();
+  void Add(const LatencyHistogram &h);
+  uint64_t Percentile(double q) const;
+};
+
+/*
+* Per-stage latency of handled telemetry frames. Every thread records into
+* its own shard so event loops never share a cache line.
+*/
+void recordStageLatency(const uint32_t stage_ns[STAGE_COUNT]);
+
+/*
+* Merge the shards of all threads.
+*/
+void snapshotStageLatency(HistogramSnapshot snapshot[STAGE_COUNT]);
+
+extern const char *kStageName[STAGE_COUNT];
+
+/*
+* Print count, p50, p99, p99.9 and max of every stage.
+*/
+void dumpStageLatency(std::ostream &o);
+
+#endif /* LATENCY_H */
@@ -0,0 +1,436 @@
+// Synthetic SocketIO telemetry load generator for ./pid.
+//
+//   ./pid_loadgen [--host=127.0.0.1] [--port=4567] [--connections=M]
+//                 [--threads=T] [--rate=HZ] [--duration=S] [--replay=frames.txt]
+//                 [--timeout=MS]
+//
+// Opens M websocket connections and speaks the simulator protocol: sends
+// 42["telemetry",{...}] and waits for the 42["steer",...] reply before the
+// next frame. Telemetry comes from the headless kinematic simulator driven by
+// the replies (closed loop), or from a frame file. With --rate every
+// connection is paced to that many frames per second, otherwise it sends as
+// fast as the server answers. Reports throughput and the latency from
+// telemetry send to steer receipt. A frame not answered within --timeout
+// is counted as lost and the connection is reopened, so a late reply is
+// never taken for the next frame.
+//
+// A minimal websocket client on plain sockets and poll() is used so pacing
+// and timestamps are not subject to another event loop.
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include "args.hxx"
+#include "sim.h"
+#include "strconv.h"
+#include "timing.h"
+
+enum CONN_STATE
+{
+    CONN_HANDSHAKE = 0,
+    CONN_OPEN,
+    CONN_CLOSED
+};
+
+struct Connection {
+  int                       fd;
+  CONN_STATE                state;
+  std::string               rx;
+  std::string               tx;
+  std::unique_ptr<VehicleSim> sim;
+  size_t                    replay_pos;
+  bool                      waiting;     // telemetry sent, steer not yet received
+  uint64_t                  sent_ns;
+  uint64_t                  due_ns;      // earliest time of the next telemetry
+};
+
+struct Options {
+  std::string               host;
+  int                       port;
+  int                       connections;
+  double                    rate;
+  double                    duration;
+  uint64_t                  timeout_ns;  // reply timeout, the frame counts as lost
+  std::vector<std::string> *replay;
+};
+
+struct WorkerStats {
+  uint64_t                  sent;
+  uint64_t                  received;
+  uint64_t                  failed;
+  uint64_t                  lost;        // telemetry without a reply within the timeout
+  uint64_t                  reconnects;  // connections reopened after a lost reply
+  std::vector<uint32_t>     latency_ns;
+};
+
+static std::atomic<bool> g_stop(false);
+
+static int connectTo(const std::string &host, int port) {
+    struct addrinfo hints, *res = nullptr;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family   = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    if (getaddrinfo(host.c_str(), std::to_string(port).c_str(), &hints, &res) != 0) {
+        return -1;
+    }
+    int fd = socket(res->ai_family, res->ai_socktype, res->ai_protocol);
+    if (fd >= 0 && connect(fd, res->ai_addr, res->ai_addrlen) != 0) {
+        close(fd);
+        fd = -1;
+    }
+    freeaddrinfo(res);
+    if (fd >= 0) {
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        // a full send buffer must not stall the other connections of the worker
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+    }
+    return fd;
+}
+
+// Client frames must be masked, a fixed key is as good as any for a load test.
+static void appendTextFrame(std::string &out, const char *data, size_t length) {
+    static const unsigned char key[4] = {0x12, 0x34, 0x56, 0x78};
+    out.push_back(static_cast<char>(0x81));
+    if (length < 126) {
+        out.push_back(static_cast<char>(0x80 | length));
+    } else {
+        out.push_back(static_cast<char>(0x80 | 126));
+        out.push_back(static_cast<char>((length >> 8) & 0xff));
+        out.push_back(static_cast<char>(length & 0xff));
+    }
+    out.append(reinterpret_cast<const char *>(key), 4);
+    for (size_t i = 0; i < length; i++) {
+        out.push_back(data[i] ^ key[i & 3]);
+    }
+}
+
+static bool flush(Connection &c) {
+    while (!c.tx.empty()) {
+        ssize_t n = send(c.fd, c.tx.data(), c.tx.size(), MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) return true;
+            return false;
+        }
+        c.tx.erase(0, n);
+    }
+    return true;
+}
+
+static void sendTelemetry(Connection &c, const Options &opt) {
+    if (opt.replay) {
+        const std::string &f = (*opt.replay)[c.replay_pos++ % opt.replay->size()];
+        appendTextFrame(c.tx, f.data(), f.size());
+    } else {
+        char buf[256];
+        Telemetry tel = c.sim->Read();
+        int n = snprintf(buf, sizeof(buf),
+                         "42[\"telemetry\",{\"cte\":\"%.4f\",\"speed\":\"%.4f\",\"steering_angle\":\"%.4f\",\"throttle\":\"0.0000\"}]",
+                         tel.cte, tel.speed, tel.steering_angle);
+        appendTextFrame(c.tx, buf, n);
+    }
+    c.waiting = true;
+    c.sent_ns = nowNs();
+}
+
+// Reads steering_angle and throttle out of a steer reply.
+static bool parseSteer(const char *p, size_t length, double &steer, double &throttle) {
+    const char *end = p + length;
+    const char *s = static_cast<const char *>(memmem(p, length, "\"steering_angle\":", 17));
+    const char *t = static_cast<const char *>(memmem(p, length, "\"throttle\":", 11));
+    if (s == nullptr || t == nullptr) return false;
+    s += 17;
+    t += 11;
+    const char *s_end = s;
+    while (s_end < end && *s_end != ',' && *s_end != '}') s_end++;
+    const char *t_end = t;
+    while (t_end < end && *t_end != ',' && *t_end != '}') t_end++;
+    return parseDouble(s, s_end, steer) == PARSE_OK && parseDouble(t, t_end, throttle) == PARSE_OK;
+}
+
+static void onText(Connection &c, const char *data, size_t length, WorkerStats &stats) {
+    if (length > 10 && memcmp(data, "42[\"steer\"", 10) == 0) {
+        if (!c.waiting) return;
+        uint64_t now = nowNs();
+        stats.received++;
+        stats.latency_ns.push_back(static_cast<uint32_t>(std::min<uint64_t>(now - c.sent_ns, UINT32_MAX)));
+        double steer, throttle;
+        if (c.sim && parseSteer(data, length, steer, throttle)) {
+            c.sim->Step(steer, throttle);
+        }
+        c.waiting = false;
+    } else if (length >= 10 && memcmp(data, "42[\"reset\"", 10) == 0) {
+        if (c.sim) c.sim->Reset();
+    } else if (length >= 11 && memcmp(data, "42[\"manual\"", 11) == 0) {
+        // reply to a frame without data, nothing to steer
+        c.waiting = false;
+    }
+}
+
+// Consume complete server frames from rx, server frames are not masked.
+static void readFrames(Connection &c, WorkerStats &stats) {
+    size_t pos = 0;
+    for (;;) {
+        const unsigned char *p = reinterpret_cast<const unsigned char *>(c.rx.data()) + pos;
+        size_t avail = c.rx.size() - pos;
+        if (avail < 2) break;
+        int opcode = p[0] & 0x0f;
+        uint64_t len = p[1] & 0x7f;
+        size_t hdr = 2;
+        if (len == 126) {
+            if (avail < 4) break;
+            len = (uint64_t(p[2]) << 8) | p[3];
+            hdr = 4;
+        } else if (len == 127) {
+            if (avail < 10) break;
+            len = 0;
+            for (int i = 0; i < 8; i++) len = (len << 8) | p[2 + i];
+            hdr = 10;
+        }
+        if (p[1] & 0x80) hdr += 4;
+        if (avail < hdr + len) break;
+
+        const char *payload = reinterpret_cast<const char *>(p + hdr);
+        if (opcode == 1) {
+            onText(c, payload, len, stats);
+        } else if (opcode == 8) {
+            c.state = CONN_CLOSED;
+        }
+        pos += hdr + len;
+    }
+    c.rx.erase(0, pos);
+}
+
+// Connect and send the websocket upgrade, the frame file position is kept.
+static void openConnection(Connection &c, const Options &opt, WorkerStats &stats) {
+    c.fd      = connectTo(opt.host, opt.port);
+    c.state   = CONN_HANDSHAKE;
+    c.waiting = false;
+    c.sent_ns = 0;
+    c.due_ns  = 0;
+    c.rx.clear();
+    c.tx.clear();
+    if (c.fd < 0) {
+        c.state = CONN_CLOSED;
+        stats.failed++;
+        return;
+    }
+    c.tx = "GET / HTTP/1.1\r\nHost: " + opt.host + ":" + std::to_string(opt.port) +
+           "\r\nUpgrade: websocket\r\nConnection: Upgrade\r\n"
+           "Sec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\nSec-WebSocket-Version: 13\r\n\r\n";
+    flush(c);
+}
+
+// Whole milliseconds until ns have passed, rounded up so a wait of less than
+// a millisecond sleeps in poll() instead of spinning on a zero timeout.
+static int pollMs(uint64_t ns) {
+    return static_cast<int>(std::min<uint64_t>((ns + 999999) / 1000000, 1000));
+}
+
+static void worker(const Options &opt, int n_conn, WorkerStats &stats, const Track &track) {
+    stats.sent = stats.received = stats.failed = stats.lost = stats.reconnects = 0;
+
+    std::vector<Connection> conns(n_conn);
+    for (auto &c : conns) {
+        c.replay_pos = 0;
+        if (!opt.replay) c.sim.reset(new VehicleSim(track));
+        openConnection(c, opt, stats);
+    }
+
+    const uint64_t period_ns = opt.rate > 0 ? static_cast<uint64_t>(1e9 / opt.rate) : 0;
+    std::vector<struct pollfd> fds(n_conn);
+    char buf[65536];
+    while (!g_stop.load(std::memory_order_relaxed)) {
+        uint64_t now = nowNs();
+        int timeout_ms = 10;
+        for (int i = 0; i < n_conn; i++) {
+            Connection &c = conns[i];
+            if (c.state == CONN_OPEN && c.waiting) {
+                if (now - c.sent_ns >= opt.timeout_ns) {
+                    // give up on this reply. Replies carry no frame id, a late
+                    // one would be taken for the next frame and skew both its
+                    // latency and the vehicle, so start over on a new
+                    // connection (a new controller on the server side) with
+                    // the vehicle back at the start.
+                    stats.lost++;
+                    stats.reconnects++;
+                    close(c.fd);
+                    if (c.sim) c.sim->Reset();
+                    openConnection(c, opt, stats);
+                } else {
+                    timeout_ms = std::min(timeout_ms, pollMs(c.sent_ns + opt.timeout_ns - now));
+                }
+            }
+            if (c.state == CONN_OPEN && !c.waiting) {
+                if (now >= c.due_ns) {
+                    sendTelemetry(c, opt);
+                    stats.sent++;
+                    c.due_ns = period_ns ? std::max(c.due_ns + period_ns, now) : 0;
+                    if (!flush(c)) c.state = CONN_CLOSED;
+                } else {
+                    timeout_ms = std::min(timeout_ms, pollMs(c.due_ns - now));
+                }
+            }
+            fds[i].fd      = c.state == CONN_CLOSED ? -1 : c.fd;
+            fds[i].events  = POLLIN | (c.tx.empty() ? 0 : POLLOUT);
+            fds[i].revents = 0;
+        }
+
+        if (poll(fds.data(), n_conn, timeout_ms) < 0 && errno != EINTR) {
+            break;
+        }
+        for (int i = 0; i < n_conn; i++) {
+            Connection &c = conns[i];
+            if (fds[i].revents & POLLOUT) {
+                if (!flush(c)) c.state = CONN_CLOSED;
+            }
+            if (!(fds[i].revents & (POLLIN | POLLHUP | POLLERR))) continue;
+            ssize_t n = recv(c.fd, buf, sizeof(buf), 0);
+            if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) {
+                continue;
+            }
+            if (n <= 0) {
+                c.state = CONN_CLOSED;
+                continue;
+            }
+            c.rx.append(buf, n);
+            if (c.state == CONN_HANDSHAKE) {
+                size_t end = c.rx.find("\r\n\r\n");
+                if (end == std::string::npos) continue;
+                if (c.rx.compare(0, 12, "HTTP/1.1 101") != 0) {
+                    c.state = CONN_CLOSED;
+                    stats.failed++;
+                    continue;
+                }
+                c.rx.erase(0, end + 4);
+                c.state = CONN_OPEN;
+            }
+            readFrames(c, stats);
+        }
+    }
+
+    for (auto &c : conns) {
+        if (c.fd >= 0) close(c.fd);
+    }
+}
+
+static uint32_t percentile(std::vector<uint32_t> &v, double q) {
+    if (v.empty()) return 0;
+    size_t k = static_cast<size_t>(q * (v.size() - 1));
+    std::nth_element(v.begin(), v.begin() + k, v.end());
+    return v[k];
+}
+
+int main(int argc, char* argv[])
+{
+    args::ArgumentParser parser("generates simulator telemetry load against the pid server");
+    args::HelpFlag help(parser, "help", "Display help menu", {'h', "help"});
+    args::ValueFlag<std::string> host(parser, "host", "server address, default 127.0.0.1", {"host"});
+    args::ValueFlag<int>    port(parser, "int", "server port, default 4567", {"port"});
+    args::ValueFlag<int>    connections(parser, "int", "number of simulated vehicles, default 1", {'c', "connections"});
+    args::ValueFlag<int>    threads(parser, "int", "client threads the connections are split over, default 1", {"threads"});
+    args::ValueFlag<double> rate(parser, "float", "telemetry frames per second per connection, default as fast as replies arrive", {"rate"});
+    args::ValueFlag<double> duration(parser, "float", "seconds to run, default 10", {"duration"});
+    args::ValueFlag<std::string> replay(parser, "file", "send frames from this file instead of the vehicle model", {"replay"});
+    args::ValueFlag<double> timeout(parser, "float", "ms to wait for a steer reply before the frame counts as lost, default 1000", {"timeout"});
+
+    try
+    {
+        parser.ParseCLI(argc, argv);
+    }
+    catch (args::Help)
+    {
+        std::cout << parser;
+        return 0;
+    }
+    catch (args::ParseError e)
+    {
+        std::cerr << e.what() << std::endl;
+        std::cerr << parser;
+        return 1;
+    }
+    catch (args::ValidationError e)
+    {
+        std::cerr << e.what() << std::endl;
+        std::cerr << parser;
+        return 1;
+    }
+
+    std::vector<std::string> frames;
+    Options opt;
+    opt.host        = host ? args::get(host) : "127.0.0.1";
+    opt.port        = port ? args::get(port) : 4567;
+    opt.connections = connections ? std::max(1, args::get(connections)) : 1;
+    opt.rate        = rate ? args::get(rate) : 0;
+    opt.duration    = duration ? args::get(duration) : 10;
+    opt.timeout_ns  = static_cast<uint64_t>((timeout ? std::max(1.0, args::get(timeout)) : 1000) * 1e6);
+    opt.replay      = nullptr;
+    if (replay) {
+        std::ifstream in(args::get(replay));
+        std::string line;
+        while (std::getline(in, line)) {
+            if (!line.empty()) frames.push_back(line);
+        }
+        if (frames.empty()) {
+            std::cerr << "[Error] No frames in " << args::get(replay) << std::endl;
+            return 1;
+        }
+        opt.replay = &frames;
+    }
+
+    int n_threads = threads ? std::max(1, std::min(args::get(threads), opt.connections)) : 1;
+    Track track = Track::LakeLike();
+    std::vector<WorkerStats> stats(n_threads);
+    std::vector<std::thread> workers;
+    for (int t = 0; t < n_threads; t++) {
+        int n_conn = opt.connections / n_threads + (t < opt.connections % n_threads ? 1 : 0);
+        workers.emplace_back(worker, std::cref(opt), n_conn, std::ref(stats[t]), std::cref(track));
+    }
+    auto t0 = std::chrono::steady_clock::now();
+    std::this_thread::sleep_for(std::chrono::duration<double>(opt.duration));
+    g_stop.store(true);
+    for (auto &w : workers) {
+        w.join();
+    }
+    double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+
+    WorkerStats total;
+    total.sent = total.received = total.failed = total.lost = total.reconnects = 0;
+    for (auto &s : stats) {
+        total.sent     += s.sent;
+        total.received += s.received;
+        total.failed   += s.failed;
+        total.lost     += s.lost;
+        total.reconnects += s.reconnects;
+        total.latency_ns.insert(total.latency_ns.end(), s.latency_ns.begin(), s.latency_ns.end());
+    }
+
+    std::printf("connections: %d (%" PRIu64 " failed), threads: %d, %.1f s\n",
+                opt.connections, total.failed, n_threads, sec);
+    std::printf("telemetry sent: %" PRIu64 ", steer received: %" PRIu64 ", %.0f frames/sec\n",
+                total.sent, total.received, total.received / sec);
+    std::printf("lost (no reply within %.0f ms): %" PRIu64 ", reconnects: %" PRIu64 "\n",
+                opt.timeout_ns / 1e6, total.lost, total.reconnects);
+    std::printf("latency (us) p50: %.1f, p90: %.1f, p99: %.1f, p99.9: %.1f, max: %.1f\n",
+                percentile(total.latency_ns, 0.50) / 1e3, percentile(total.latency_ns, 0.90) / 1e3,
+                percentile(total.latency_ns, 0.99) / 1e3, percentile(total.latency_ns, 0.999) / 1e3,
+                percentile(total.latency_ns, 1.0) / 1e3);
+    return total.received ? 0 : 1;
+}
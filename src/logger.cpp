@@ -0,0 +1,212 @@
+#include "logger.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <thread>
+
+static std::atomic<LogRing *> g_rings(nullptr);
+static std::atomic<int>       g_level(LOG_OFF);
+static std::atomic<bool>      g_running(false);
+static std::thread            g_writer;
+
+static thread_local LogRing  *t_ring = nullptr;
+
+// One ring per producer thread, created on first use and kept until exit.
+static LogRing *threadRing() {
+    if (t_ring == nullptr) {
+        void *mem = nullptr;
+        if (posix_memalign(&mem, 64, sizeof(LogRing)) != 0) {
+            return nullptr;
+        }
+        LogRing *ring = new (mem) LogRing();
+        ring->next = g_rings.load(std::memory_order_relaxed);
+        while (!g_rings.compare_exchange_weak(ring->next, ring, std::memory_order_release)) {}
+        t_ring = ring;
+    }
+    return t_ring;
+}
+
+static void format(std::ostream &o, const LogRecord &rec) {
+    switch (rec.kind) {
+        case LOG_KIND_TELEMETRY:
+            o << "cte: "        << std::setw(8) << rec.d[0]
+              << ", speed: "    << std::setw(8) << rec.d[1]
+              << ", angle: "    << std::setw(8) << rec.d[2]
+              << ", d_angle: "  << std::setw(8) << rec.d[3]
+              << '\n';
+            break;
+
+        case LOG_KIND_ACTUATION:
+            o << "Actuations: throttle: " << rec.d[0]
+              << ", steer: " << rec.d[1] << '\n';
+            break;
+
+        case LOG_KIND_TWIDDLE:
+            o << "\repoch: "      << std::setw(3) << rec.i[0]
+              << ", step: "       << std::setw(4) << rec.i[1]
+              << ", gain_idx: "   << std::setw(1) << rec.i[2]
+              << ", state: "      << std::setw(1) << rec.i[3]
+              << ", kp: "         << std::setw(6) << rec.d[0]
+              << ", ki: "         << std::setw(6) << rec.d[1]
+              << ", kd:"          << std::setw(6) << rec.d[2]
+              << ", dp: "         << std::setw(6) << rec.d[3]
+              << ", di: "         << std::setw(6) << rec.d[4]
+              << ", dd: "         << std::setw(6) << rec.d[5]
+              << ", Best SSE: "   << std::setw(10) << rec.d[6]
+              << ", SSE: "        << std::setw(10) << rec.d[7];
+            break;
+
+        case LOG_KIND_TEXT_PART:
+            o.write(rec.text, rec.length);
+            break;
+
+        default:
+            o.write(rec.text, rec.length);
+            o << '\n';
+            break;
+    }
+}
+
+static bool drain(std::ostream &o) {
+    bool any = false;
+    LogRecord rec;
+    for (LogRing *ring = g_rings.load(std::memory_order_acquire); ring; ring = ring->next) {
+        while (ring->Pop(rec)) {
+            format(o, rec);
+            any = true;
+        }
+    }
+    if (any) {
+        o.flush();
+    }
+    return any;
+}
+
+static void writerLoop() {
+    std::cout.precision(3);
+    while (g_running.load(std::memory_order_acquire)) {
+        if (!drain(std::cout)) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+    drain(std::cout);
+}
+
+void logStart(int level) {
+    if (g_running.exchange(true)) {
+        return;
+    }
+    g_level.store(level, std::memory_order_relaxed);
+    g_writer = std::thread(writerLoop);
+}
+
+void logStop() {
+    if (!g_running.exchange(false)) {
+        return;
+    }
+    g_writer.join();
+    g_level.store(LOG_OFF, std::memory_order_relaxed);
+
+    uint64_t dropped = logDropped();
+    if (dropped) {
+        std::cout << "[Warn] Dropped " << dropped << " log records" << std::endl;
+    }
+}
+
+bool logEnabled(int level) {
+    return level >= g_level.load(std::memory_order_relaxed);
+}
+
+uint64_t logDropped() {
+    uint64_t dropped = 0;
+    for (LogRing *ring = g_rings.load(std::memory_order_acquire); ring; ring = ring->next) {
+        dropped += ring->dropped.load(std::memory_order_relaxed);
+    }
+    return dropped;
+}
+
+static inline void push(const LogRecord &rec) {
+    LogRing *ring = threadRing();
+    if (ring != nullptr) {
+        ring->Push(rec);
+    }
+}
+
+void logText(int level, const char *text, size_t length) {
+    LogRing *ring = threadRing();
+    if (ring == nullptr) {
+        return;
+    }
+    static const char kMore[] = "...";
+    bool truncated = length > kLogTextMax;
+    if (truncated) {
+        length = kLogTextMax - (sizeof(kMore) - 1);
+    }
+    const size_t chunk = sizeof(LogRecord::text);
+    size_t total = length + (truncated ? sizeof(kMore) - 1 : 0);
+    size_t n_records = total == 0 ? 1 : (total + chunk - 1) / chunk;
+    if (ring->Free() < n_records) {
+        ring->dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    LogRecord rec;
+    rec.level = level;
+    size_t pos = 0;
+    for (size_t r = 0; r < n_records; r++) {
+        size_t n = std::min(chunk, total - pos);
+        // the message, then the marker, may straddle a record boundary
+        for (size_t k = 0; k < n; k++, pos++) {
+            rec.text[k] = pos < length ? text[pos] : kMore[pos - length];
+        }
+        rec.kind   = r + 1 < n_records ? LOG_KIND_TEXT_PART : LOG_KIND_TEXT;
+        rec.length = n;
+        ring->Push(rec);
+    }
+}
+
+void logTelemetry(double cte, double speed, double angle, double d_angle) {
+    LogRecord rec;
+    rec.level = LOG_INFO;
+    rec.kind  = LOG_KIND_TELEMETRY;
+    rec.d[0]  = cte;
+    rec.d[1]  = speed;
+    rec.d[2]  = angle;
+    rec.d[3]  = d_angle;
+    push(rec);
+}
+
+void logActuation(double throttle, double steer) {
+    LogRecord rec;
+    rec.level = LOG_INFO;
+    rec.kind  = LOG_KIND_ACTUATION;
+    rec.d[0]  = throttle;
+    rec.d[1]  = steer;
+    push(rec);
+}
+
+void logTwiddle(int epoch, int step, int gain_idx, int state,
+                double kp, double ki, double kd,
+                double dp, double di, double dd,
+                double best_sse, double sse) {
+    LogRecord rec;
+    rec.level = LOG_INFO;
+    rec.kind  = LOG_KIND_TWIDDLE;
+    rec.i[0]  = epoch;
+    rec.i[1]  = step;
+    rec.i[2]  = gain_idx;
+    rec.i[3]  = state;
+    rec.d[0]  = kp;
+    rec.d[1]  = ki;
+    rec.d[2]  = kd;
+    rec.d[3]  = dp;
+    rec.d[4]  = di;
+    rec.d[5]  = dd;
+    rec.d[6]  = best_sse;
+    rec.d[7]  = sse;
+    push(rec);
+}
@@ -0,0 +1,130 @@
+#ifndef LOGGER_H
+#define LOGGER_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+/*
+* Asynchronous logging. The control loop pushes fixed-size binary records
+* into a per-thread single-producer/single-consumer ring and never blocks,
+* a background thread formats them and does the console I/O. When a ring is
+* full the record is dropped and counted.
+*/
+
+enum LOG_LEVEL
+{
+    LOG_DEBUG = 0,
+    LOG_INFO,
+    LOG_WARN,
+    LOG_ERROR,
+    LOG_OFF
+};
+
+// Log statements below this level are compiled out, e.g. -DPID_LOG_LEVEL=4
+// removes all of them from the hot path.
+#ifndef PID_LOG_LEVEL
+#define PID_LOG_LEVEL 0
+#endif
+
+#define PID_LOG(level, call)                                    \
+    do {                                                        \
+        if ((level) >= PID_LOG_LEVEL && logEnabled(level)) {    \
+            call;                                               \
+        }                                                       \
+    } while (0)
+
+enum LOG_KIND
+{
+    LOG_KIND_TEXT = 0,
+    LOG_KIND_TEXT_PART,   // text continued in the next record
+    LOG_KIND_TELEMETRY,
+    LOG_KIND_ACTUATION,
+    LOG_KIND_TWIDDLE
+};
+
+struct LogRecord {
+  uint8_t  level;
+  uint8_t  kind;
+  uint16_t length;     // text length for LOG_KIND_TEXT
+  int32_t  i[4];
+  union {
+    double d[13];
+    char   text[104];  // not null terminated, longer text spans records
+  };
+};
+
+static_assert(sizeof(LogRecord) == 128, "LogRecord is two cache lines");
+
+/*
+* Bounded lock-free ring, one producer thread and the writer thread.
+*/
+class LogRing {
+public:
+  static const size_t kCapacity = 4096;  // power of two
+
+  LogRing() : head(0), tail(0), dropped(0), next(nullptr) {}
+
+  bool Push(const LogRecord &rec) {
+    size_t h = head.load(std::memory_order_relaxed);
+    if (h - tail.load(std::memory_order_acquire) == kCapacity) {
+      dropped.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+    records[h & (kCapacity - 1)] = rec;
+    head.store(h + 1, std::memory_order_release);
+    return true;
+  }
+
+  size_t Free() const {
+    return kCapacity - (head.load(std::memory_order_relaxed) - tail.load(std::memory_order_acquire));
+  }
+
+  bool Pop(LogRecord &rec) {
+    size_t t = tail.load(std::memory_order_relaxed);
+    if (t == head.load(std::memory_order_acquire)) {
+      return false;
+    }
+    rec = records[t & (kCapacity - 1)];
+    tail.store(t + 1, std::memory_order_release);
+    return true;
+  }
+
+  alignas(64) std::atomic<size_t>   head;
+  alignas(64) std::atomic<size_t>   tail;
+  alignas(64) std::atomic<uint64_t> dropped;
+  LogRing                          *next;   // list of all rings, for the writer
+  LogRecord                         records[kCapacity];
+};
+
+/*
+* Start the writer thread, records below level are discarded at runtime.
+*/
+void logStart(int level);
+
+/*
+* Drain all rings, stop the writer thread and report dropped records.
+*/
+void logStop();
+
+bool logEnabled(int level);
+
+uint64_t logDropped();
+
+// Longest text logText() keeps, longer text ends in "..." at this length.
+static const size_t kLogTextMax = 16 * sizeof(LogRecord::text);
+
+/*
+* Record producers, called through PID_LOG() on the hot path. Text longer
+* than one record is split over consecutive records of the same ring, all
+* of them or none are queued.
+*/
+void logText(int level, const char *text, size_t length);
+void logTelemetry(double cte, double speed, double angle, double d_angle);
+void logActuation(double throttle, double steer);
+void logTwiddle(int epoch, int step, int gain_idx, int state,
+                double kp, double ki, double kd,
+                double dp, double di, double dd,
+                double best_sse, double sse);
+
+#endif /* LOGGER_H */
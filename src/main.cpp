@@ -1,43 +1,206 @@
 #include <uWS/uWS.h>
+#include <algorithm>
+#include <atomic>
+#include <cassert>
 #include <iostream>
-#include "json.hpp"
+#include <memory>
+#include <thread>
+#include <vector>
+#include <pthread.h>
+#include <signal.h>
+#include <unistd.h>
 #include "PID.h"
+#include "gain_schedule.h"
+#include "gains.h"
+#include "handler.h"
+#include "latency.h"
+#include "logger.h"
+#include "metrics.h"
+#include "recorder.h"
 #include <math.h>
 #include "args.hxx"
 
-// for convenience
-using json = nlohmann::json;
-
 // For converting back and forth between radians and degrees.
 constexpr double pi() { return M_PI; }
 double deg2rad(double x) { return x * pi() / 180; }
 double rad2deg(double x) { return x * 180 / pi(); }
 
-// Checks if the SocketIO event has JSON data.
-// If there is data the JSON object in string format will be returned,
-// else the empty string "" will be returned.
-std::string hasData(std::string s) {
-    auto found_null = s.find("null");
-    auto b1 = s.find_first_of("[");
-    auto b2 = s.find_last_of("]");
+// Sends handler replies to the simulator.
+class WebSocketSink : public MessageSink {
+public:
+  WebSocketSink(uWS::WebSocket<uWS::SERVER> ws) : ws(ws) {}
+
+  void Send(const char *data, size_t length) {
+    ws.send(data, length, uWS::OpCode::TEXT);
+  }
+
+private:
+  uWS::WebSocket<uWS::SERVER> ws;
+};
+
+// Leaves the process while other event loops may still be running: drains the
+// console and prints the stage latency once, then _exit. exit() would run the
+// atexit handlers and static destructors under their feet. The flight records
+// are shared mappings and survive it. A second caller waits for the first.
+static void quit(int status)
+{
+  static std::atomic<bool> quitting(false);
+  if (quitting.exchange(true)) {
+    for (;;) {
+      pause();
+    }
+  }
+  logStop();
+  dumpStageLatency(std::cout);
+  std::cout.flush();
+  _exit(status);
+}
+
+// Runs one event loop serving its own connections. Nothing in it is shared
+// with other loops, so the message path takes no locks.
+static int runHub(const Handler &config, int port, int listen_options)
+{
+  uWS::Hub h;
 
-    if (found_null != std::string::npos) {
-        return "";
+  h.onMessage([](uWS::WebSocket<uWS::SERVER> ws, char *data, size_t length, uWS::OpCode opCode) {
+    Handler *handler = static_cast<Handler *>(ws.getUserData());
+    if (handler == nullptr) {
+      return;
+    }
+    WebSocketSink sink(ws);
+    if (handler->OnMessage(data, length, sink) == HANDLE_TWIDDLE_DONE) {
+      quit(1);
+    }
+  });
+
+  // /metrics in Prometheus text format and /stats as JSON, everything else
+  // gets the old hello page. Scrapes only read relaxed atomics and the
+  // histogram shards, they never wait for a control loop.
+  h.onHttpRequest([](uWS::HttpResponse *res, uWS::HttpRequest req, char *data, size_t length, size_t remaining) {
+    uWS::Header url = req.getUrl();
+    std::string path(url.value, url.valueLength);
+    std::string query;
+    size_t q = path.find('?');
+    if (q != std::string::npos) {
+      query = path.substr(q + 1);
+      path.resize(q);
+    }
+    if (path == "/metrics")
+    {
+      const std::string s = metricsText();
+      res->end(s.data(), s.length());
     }
-    else if (b1 != std::string::npos && b2 != std::string::npos) {
-        return s.substr(b1, b2 - b1 + 1);
+    else if (path == "/stats")
+    {
+      const std::string s = statsJson();
+      res->end(s.data(), s.length());
+    }
+    else if (path == "/gains")
+    {
+      // POST /gains?kp=..&ki=..&kd=..[&reset_i=1], or the same as form body
+      if (query.empty() && remaining == 0) {
+        query.assign(data, length);
+      }
+      GainRequest gains;
+      std::string s;
+      if (req.getMethod() != uWS::METHOD_POST || !parseGainQuery(query.data(), query.length(), gains)) {
+        s = "error: expected POST /gains?kp=..&ki=..&kd=..[&reset_i=1]\n";
+      } else {
+        uint64_t version = publishGains(gains.kp, gains.ki, gains.kd, gains.reset_i);
+        s = "gains v" + std::to_string(version) + "\n";
+      }
+      res->end(s.data(), s.length());
+    }
+    else if (url.valueLength == 1)
+    {
+      const std::string s = "<h1>Hello world!</h1>";
+      res->end(s.data(), s.length());
     }
-    return "";
+    else
+    {
+      // i guess this should be done more gracefully?
+      res->end(nullptr, 0);
+    }
+  });
+
+  // controller, tuner and cost accumulator state lives with the connection,
+  // so simulators connected at the same time do not share it
+  h.onConnection([&config](uWS::WebSocket<uWS::SERVER> ws, uWS::HttpRequest req) {
+    //std::cout << "Connected!!!" << std::endl;
+    Handler *handler = new Handler(config);
+    assert(isCacheAligned(&handler->pid_steer));
+    handler->stats = openSession();
+    ws.setUserData(handler);
+  });
+
+  h.onDisconnection([](uWS::WebSocket<uWS::SERVER> ws, int code, char *message, size_t length) {
+    Handler *handler = static_cast<Handler *>(ws.getUserData());
+    if (handler != nullptr) {
+      closeSession(handler->stats);
+      delete handler;
+    }
+    ws.setUserData(nullptr);
+    ws.close();
+    std::cout << "Disconnected" << std::endl;
+  });
+
+  if (h.listen(port, nullptr, listen_options))
+  {
+    std::cout << "Listening to port " << port << std::endl;
+  }
+  else
+  {
+    std::cerr << "Failed to listen to port" << std::endl;
+    return -1;
+  }
+  h.run();
+  return 0;
 }
 
-int main(int argc, char* argv[])
+// Pin the calling thread to a core, no-op where affinity is not supported.
+static void pinToCore(int index)
 {
- 
-    uWS::Hub h;
+#ifdef __linux__
+  int n_cores = std::thread::hardware_concurrency();
+  if (n_cores <= 0) {
+    return;
+  }
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  CPU_SET(index % n_cores, &set);
+  pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+#endif
+}
 
-    PID pid_steer;
-    int step = 0;
-    float SSE = 0; //sum of square error for twiddle
+static void dumpLatency()
+{
+  dumpStageLatency(std::cout);
+}
+
+// SIGUSR1 prints the stage latency histograms, SIGINT and SIGTERM print them
+// once more and quit. The signals are blocked in every other thread and taken
+// here, the event loops are never interrupted.
+static void signalLoop(sigset_t set)
+{
+  for (;;) {
+    int sig = 0;
+    if (sigwait(&set, &sig) != 0) {
+      continue;
+    }
+    if (sig == SIGUSR1) {
+      dumpStageLatency(std::cout);
+    } else {
+      quit(0);
+    }
+  }
+}
+
+int main(int argc, char* argv[])
+{
+    // controller set up from the CLI, every connection gets its own copy
+    Handler config;
+    PID &pid_steer = config.pid_steer;
+    TwiddleTuner &tuner = config.tuner;
 
     args::ArgumentParser parser("an PID controller app that drives Udacity SDC Simulator Lake Track", "Running ./pid without any argument invokes pre-tuned gain.");
     args::HelpFlag help(parser, "help", "Display help menu", {'h', "help"});
@@ -51,6 +214,29 @@ int main(int argc, char* argv[])
     args::ValueFlag<float>  dp(dgain_grp, "float", "kp max tunable range", {"dp"});
     args::ValueFlag<float>  di(dgain_grp, "float", "ki max tunable range", {"di"});
     args::ValueFlag<float>  dd(dgain_grp, "float", "kd max tunable range", {"dd"});
+    args::ValueFlag<int>    log_level(parser, "int", "console log level, 0: debug, 1: info, 2: warn, 3: error, 4: off", {"log_level"});
+    args::ValueFlag<std::string> record(parser, "file", "record every control step to a binary ring file", {"record"});
+    args::ValueFlag<int>    record_size(parser, "int", "number of steps kept in the record file, default 1048576", {"record_size"});
+    args::ValueFlag<std::string> record_frames(parser, "file", "record every received frame as is, the input of pid_replay", {"record_frames"});
+    args::ValueFlag<int>    record_frames_mb(parser, "int", "size of the frame file in MiB, later frames are dropped, default 64", {"record_frames_mb"});
+    args::ValueFlag<int>    threads(parser, "int", "number of event loops, each on its own core, default 1", {"threads"});
+    args::ValueFlag<double> dt_ref(parser, "float", "scale integral and derivative by the real time between frames, s is the frame interval the gains were tuned at", {"dt_ref"});
+    args::ValueFlag<double> dt_clamp(parser, "float", "limit frame intervals to [dt_ref/k, dt_ref*k], default 4", {"dt_clamp"});
+    args::ValueFlag<double> target_speed(parser, "float", "drive at this speed in mph with a throttle PID instead of the fixed throttle law", {"speed"});
+    args::Group tgain_grp(parser, "tp, ti, td need to coexist", args::Group::Validators::AllOrNone);
+    args::ValueFlag<float>  tp(tgain_grp, "float", "throttle proportional gain, default 0.2", {"tp"});
+    args::ValueFlag<float>  ti(tgain_grp, "float", "throttle integral gain, default 0.005", {"ti"});
+    args::ValueFlag<float>  td(tgain_grp, "float", "throttle derivative gain, default 0", {"td"});
+    args::ValueFlag<double> speed_drop(parser, "float", "fraction of the target speed shed at full steering, default 0.15", {"speed_drop"});
+    args::ValueFlag<std::string> schedule(parser, "file", "steering gains scheduled by speed from a table written by pid_tune --schedule_out", {"schedule"});
+    args::ValueFlag<double> steer_limit(parser, "float", "limit the steering output to [-v, v]", {"steer_limit"});
+    args::ValueFlag<std::string> windup(parser, "mode", "integral anti-windup: none, clamp, backcalc or conditional, limits steering to [-1, 1] without --steer_limit", {"windup"});
+    args::ValueFlag<double> kb(parser, "float", "back-calculation gain, default 1", {"kb"});
+    args::ValueFlag<std::string> d_filter(parser, "type", "low-pass on the steering derivative: none, lowpass or biquad", {"d_filter"});
+    args::ValueFlag<double> d_cutoff(parser, "float", "derivative low-pass cutoff as a fraction of the update rate, default 0.1", {"d_cutoff"});
+    args::Flag              d_measurement(parser, "d_measurement", "take the steering derivative on the measurement", {"d_measurement"});
+    args::Flag              velocity(parser, "velocity", "steer with the velocity (incremental) form of the PID", {"velocity"});
+    args::Flag              validate_json(parser, "validate_json", "cross-check telemetry and steer messages against generic json path", {"validate_json"});
 
     try
     {
@@ -74,15 +260,110 @@ int main(int argc, char* argv[])
         return 1;
     }
 
+    config.is_validate_json = validate_json;
+    if (config.is_validate_json) {
+        std::cout << "[Info] Telemetry JSON Validation Enabled" << std::endl;
+    }
+
+    if (dt_ref) {
+        config.dt_ref = args::get(dt_ref);
+        if (dt_clamp) config.dt_clamp = args::get(dt_clamp);
+        if (config.dt_ref <= 0 || config.dt_clamp < 1) {
+            std::cout << "[Error] dt_ref must be positive and dt_clamp at least 1." << std::endl;
+            exit(1);
+        }
+        std::cout << "[Info] Time-aware PID update, dt_ref: " << config.dt_ref
+                  << " s, dt_clamp: " << config.dt_clamp << std::endl;
+    }
+
+    if (target_speed || tp) {
+        SpeedControl &sc = config.speed_control;
+        if (target_speed) sc.target_speed = args::get(target_speed);
+        if (speed_drop) sc.steer_drop = args::get(speed_drop);
+        if (tp && ti && td) {
+            sc.pid_throttle.Init(args::get(tp), args::get(ti), args::get(td));
+        }
+        config.is_speed_control = true;
+        sc.Print(std::cout);
+    }
+
+    // shared read-only by every connection, lives as long as the event loops
+    static GainSchedule gain_schedule;
+    if (schedule) {
+        if (twiddle) {
+            std::cout << "[Error] schedule can not be used with twiddle tuning." << std::endl;
+            exit(1);
+        }
+        if (!gain_schedule.Load(args::get(schedule).c_str())) {
+            std::cerr << "[Error] Failed to load gain schedule " << args::get(schedule) << std::endl;
+            return 1;
+        }
+        config.schedule = &gain_schedule;
+        std::cout << "[Info] Gain schedule with " << gain_schedule.SpeedBands() << " speed and "
+                  << gain_schedule.RateBands() << " cte rate bands" << std::endl;
+    }
+
+    if (velocity && (windup || kb)) {
+        std::cout << "[Error] --velocity clamps the output to --steer_limit only, drop --windup and --kb." << std::endl;
+        exit(1);
+    }
+
+    if (steer_limit || windup) {
+        PidLimits<double> &limits = config.limits;
+        if (steer_limit) {
+            limits.out_max = fabs(args::get(steer_limit));
+            limits.out_min = -limits.out_max;
+        }
+        std::string mode = windup ? args::get(windup) : "none";
+        if (mode == "none") {
+            limits.windup = WINDUP_NONE;
+        } else if (mode == "clamp") {
+            limits.windup = WINDUP_CLAMP;
+        } else if (mode == "backcalc") {
+            limits.windup = WINDUP_BACK_CALC;
+        } else if (mode == "conditional") {
+            limits.windup = WINDUP_CONDITIONAL;
+        } else {
+            std::cout << "[Error] windup must be none, clamp, backcalc or conditional." << std::endl;
+            exit(1);
+        }
+        if (kb) limits.kb = args::get(kb);
+        config.is_limited = true;
+        std::cout << "[Info] Steering limited to [" << limits.out_min << ", " << limits.out_max
+                  << "], anti-windup: " << mode << std::endl;
+    }
+
+    if (d_filter || d_measurement) {
+        std::string type = d_filter ? args::get(d_filter) : "none";
+        double cutoff = d_cutoff ? args::get(d_cutoff) : 0.1;
+        DFILTER t;
+        if (!parseDFilter(type, t)) {
+            std::cout << "[Error] d_filter must be none, lowpass or biquad." << std::endl;
+            exit(1);
+        }
+        if (!DerivFilter<double>::IsValidCutoff(cutoff)) {
+            std::cout << "[Error] d_cutoff must be between 0 and 0.5." << std::endl;
+            exit(1);
+        }
+        pid_steer.SetDerivFilter(t, cutoff, d_measurement);
+        std::cout << "[Info] Steering derivative filter: " << type << ", cutoff " << cutoff
+                  << (d_measurement ? ", on measurement" : "") << std::endl;
+    }
+
+    if (velocity) {
+        pid_steer.SetVelocity(true);
+        std::cout << "[Info] Velocity form PID" << std::endl;
+    }
+
     if (twiddle) {
         std::cout << "[Info] Twiddle Tuning Enabled" << std::endl;
-        pid_steer.is_twiddle = true;
+        tuner.SetEnabled(true);
     }
 
     if (n_step) {
         if (twiddle) {
-            pid_steer.twiddle_endstep = args::get(n_step);
-            std::cout << "[Info] Setting twiddle n_step to " << pid_steer.twiddle_endstep << std::endl;
+            tuner.SetEndStep(args::get(n_step));
+            std::cout << "[Info] Setting twiddle n_step to " << tuner.EndStep() << std::endl;
         } else {
             std::cout << "[Error] n_steps only works when twiddle tuning is enabled." << std::endl;
             exit(1);
@@ -92,183 +373,118 @@ int main(int argc, char* argv[])
 
     if (kp && ki && kd) {
         std::cout << "[Info] Use user-specified kp, ki, kd" << std::endl;
-        pid_steer.gain[0] = args::get(kp);
-        pid_steer.gain[1] = args::get(ki);
-        pid_steer.gain[2] = args::get(kd);
+        tuner.SetGains(args::get(kp), args::get(ki), args::get(kd));
     } else {
         std::cout << "[Info] Use pretuned kp, ki, kd" << std::endl;
-        pid_steer.gain[0] = 0.15; 
-        pid_steer.gain[1] = 0.001;
-        pid_steer.gain[2] = 0.6;
+        tuner.SetGains(0.15, 0.001, 0.6);
     }
+    const TwiddleProgress start = tuner.Progress();
     
     std::cout << "[Info] Initializing PID for steering with kp: " << 
-        pid_steer.gain[0] << 
-        ", ki: " << pid_steer.gain[1] << 
-        ", kd: " << pid_steer.gain[2] << 
+        start.gain[0] << 
+        ", ki: " << start.gain[1] << 
+        ", kd: " << start.gain[2] << 
         std::endl;
 
-    pid_steer.Init(pid_steer.gain[0], pid_steer.gain[1], pid_steer.gain[2]);
+    pid_steer.Init(start.gain[0], start.gain[1], start.gain[2]);
 
     if (dp && di && dd) {
         if (twiddle) {
             std::cout << "[Info] Use user-specified dp, di, dd" << std::endl;
-            pid_steer.d_gain[0] = args::get(dp);
-            pid_steer.d_gain[1] = args::get(di);
-            pid_steer.d_gain[2] = args::get(dd);
+            tuner.SetSteps(args::get(dp), args::get(di), args::get(dd));
         } else {
             std::cout << "[Error] dp, di, dd are to be used when twiddle tuning is enabled." << std::endl;
             exit(1);
         }
     }
     
-    if (twiddle) {
-        std::cout << "[Info] Twiddle with initial dp: " 
-				<< pid_steer.d_gain[0] <<
-            	", di: " << pid_steer.d_gain[1] <<
-            	", dd: " << pid_steer.d_gain[2] <<
-            	std::endl; 
-    }
- 
-  	h.onMessage([&pid_steer, &step, &SSE](uWS::WebSocket<uWS::SERVER> ws, char *data, size_t length, uWS::OpCode opCode) {
-    static double previous_angle = 0;
-    step++;
-    // "42" at the start of the message means there's a websocket message event.
-    // The 4 signifies a websocket message
-    // The 2 signifies a websocket event
-    if (length && length > 2 && data[0] == '4' && data[1] == '2')
-    {
-      auto s = hasData(std::string(data).substr(0, length));
-      if (s != "") {
-        auto j = json::parse(s);
-        std::string event = j[0].get<std::string>();
-        if (event == "telemetry") {
-          // j[1] is the data JSON object
-          double cte = std::stod(j[1]["cte"].get<std::string>());
-          double speed = std::stod(j[1]["speed"].get<std::string>());
-          double angle = std::stod(j[1]["steering_angle"].get<std::string>());
-          double steer_value;
-          double throttle_value;
-
-          double d_angle;
-          d_angle = previous_angle - angle;
-          previous_angle = angle;
-
-          std::cout.precision(3);
- 
-          if (!pid_steer.is_twiddle) {         
-          std::cout << "cte: "      << std::setw(8) << cte 
-                    << ", speed: "  << std::setw(8) << speed 
-                    << ", angle: "  << std::setw(8) << angle 
-                    << ", d_angle: "  << std::setw(8) << d_angle 
-                    << std::endl;
-          }
-          // Sum of square error - cost function for twiddle
-          SSE += cte*cte;               // minimize the car gap to the reference line
-          SSE += angle*angle;           // penalize large angle so that car takes small angle overall
-          SSE += pow((40 - speed),2);   //reference speed is 40, ensure car is moving, also as close to reference speed
-
-          /*
-          * TODO: Calcuate steering value here, remember the steering value is
-          * [-1, 1].
-          * NOTE: Feel free to play around with the throttle and speed. Maybe use
-          * another PID controller to control the speed!
-          */
-
-          if (pid_steer.is_twiddle) 
-          {
-            // Triggle twiddle loop when number of step reaching threshold or 
-            // when accumulated SSE is already over best SSE 
-            if ((step > pid_steer.twiddle_endstep) || (SSE > pid_steer.twiddle_best_sse)) {
-                std::cout << std::endl;
-                std::string reset_msg = "42[\"reset\",{}]";
-                ws.send(reset_msg.data(), reset_msg.length(), uWS::OpCode::TEXT);
-
-                // Call to twiddle loop - 1 to terminate, 0 continue twiddle tuning
-                if (pid_steer.Twiddle(SSE)) exit(1);
-
-                // reset step count and SSE accumulator
-                step = 0;
-                SSE = 0;
-            } 
-           
-           //Print out during tuning operation 
-            std::cout   << "\repoch: "      << std::setw(3) << pid_steer.twiddle_cnt/3 
-                        << ", step: "       << std::setw(4) << step 
-                        << ", gain_idx: "   << std::setw(1) << pid_steer.gain_idx 
-                        << ", state: "      << std::setw(1) << pid_steer.state 
-                        << ", kp: "         << std::setw(6) << pid_steer.Kp 
-                        << ", ki: "         << std::setw(6) << pid_steer.Ki 
-                        << ", kd:"          << std::setw(6) << pid_steer.Kd 
-                        << ", dp: "         << std::setw(6) << pid_steer.d_gain[0] 
-                        << ", di: "         << std::setw(6) << pid_steer.d_gain[1] 
-                        << ", dd: "         << std::setw(6) << pid_steer.d_gain[2] 
-                        << ", Best SSE: "   << std::setw(10) << pid_steer.twiddle_best_sse
-                        << ", SSE: "        << std::setw(10) << SSE ;
-
-          } 
-
-
-          pid_steer.UpdateError(cte); // call to update p, i, d error term corresponding to cte
-          steer_value = pid_steer.TotalError(); // call to calculate (-Kp*p_error) + (-Kd*d_error) + (-Ki*i_error)
-
-		  /* throttle is reduced proportionally to the change of steering angle
- 		   * the idea is when change of steering angle is large, it signifies a huge turn
- 		   * hence we need to slow down or brake */
-		  throttle_value = 0.5 - 0.3 * fabs(d_angle);
-    
-		  std::cout << "Actuations: throttle: " << throttle_value
-          		    << ", steer: " << steer_value << std::endl;
-
-          json msgJson;
-          msgJson["steering_angle"] = steer_value;
-          msgJson["throttle"] = throttle_value;
-         
-          auto msg = "42[\"steer\"," + msgJson.dump() + "]";
-          // std::cout << step << ": "<< msg << std::endl;
-          ws.send(msg.data(), msg.length(), uWS::OpCode::TEXT);
+    int n_threads = threads ? args::get(threads) : 1;
+
+    // a recorder is written by one event loop only, one file per loop
+    std::vector<std::unique_ptr<FlightRecorder>> recorders(std::max(n_threads, 1));
+    if (record) {
+        size_t capacity = record_size ? args::get(record_size) : (1 << 20);
+        for (size_t i = 0; i < recorders.size(); i++) {
+            std::string path = args::get(record);
+            if (n_threads > 1) {
+                path += "." + std::to_string(i);
+            }
+            recorders[i].reset(new FlightRecorder());
+            if (!recorders[i]->Open(path.c_str(), capacity)) {
+                std::cerr << "[Error] Failed to create record file " << path << std::endl;
+                return 1;
+            }
+            std::cout << "[Info] Recording " << capacity << " steps to " << path << std::endl;
         }
-      } else {
-        // Manual driving
-        std::string msg = "42[\"manual\",{}]";
-        ws.send(msg.data(), msg.length(), uWS::OpCode::TEXT);
-      }
+        config.recorder = recorders[0].get();
     }
-  });
 
-  // We don't need this since we're not using HTTP but if it's removed the program
-  // doesn't compile :-(
-  h.onHttpRequest([](uWS::HttpResponse *res, uWS::HttpRequest req, char *data, size_t, size_t) {
-    const std::string s = "<h1>Hello world!</h1>";
-    if (req.getUrl().valueLength == 1)
-    {
-      res->end(s.data(), s.length());
-    }
-    else
-    {
-      // i guess this should be done more gracefully?
-      res->end(nullptr, 0);
+    std::vector<std::unique_ptr<FrameRecorder>> frame_recorders(std::max(n_threads, 1));
+    if (record_frames) {
+        int mb = record_frames_mb ? args::get(record_frames_mb) : 64;
+        if (mb <= 0) {
+            std::cout << "[Error] record_frames_mb must be positive." << std::endl;
+            exit(1);
+        }
+        size_t capacity = size_t(mb) << 20;
+        for (size_t i = 0; i < frame_recorders.size(); i++) {
+            std::string path = args::get(record_frames);
+            if (n_threads > 1) {
+                path += "." + std::to_string(i);
+            }
+            frame_recorders[i].reset(new FrameRecorder());
+            if (!frame_recorders[i]->Open(path.c_str(), capacity)) {
+                std::cerr << "[Error] Failed to create frame file " << path << std::endl;
+                return 1;
+            }
+            std::cout << "[Info] Recording frames, " << (capacity >> 20) << " MiB, to " << path << std::endl;
+        }
+        config.frame_recorder = frame_recorders[0].get();
     }
-  });
 
-  h.onConnection([&h](uWS::WebSocket<uWS::SERVER> ws, uWS::HttpRequest req) {
-    //std::cout << "Connected!!!" << std::endl;
-  });
+    if (twiddle) {
+        const TwiddleProgress steps = tuner.Progress();
+        std::cout << "[Info] Twiddle with initial dp: " 
+				<< steps.d_gain[0] <<
+            	", di: " << steps.d_gain[1] <<
+            	", dd: " << steps.d_gain[2] <<
+            	std::endl; 
+    }
+ 
+  // block before any thread is started so that all of them inherit the mask
+  sigset_t signals;
+  sigemptyset(&signals);
+  sigaddset(&signals, SIGUSR1);
+  sigaddset(&signals, SIGINT);
+  sigaddset(&signals, SIGTERM);
+  pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+  std::thread(signalLoop, signals).detach();
 
-  h.onDisconnection([&h](uWS::WebSocket<uWS::SERVER> ws, int code, char *message, size_t length) {
-    ws.close();
-    std::cout << "Disconnected" << std::endl;
-  });
+  // console output is written by a background thread, drained at exit
+  logStart(log_level ? args::get(log_level) : LOG_INFO);
+  atexit(logStop);
+  atexit(dumpLatency);
 
   int port = 4567;
-  if (h.listen(port))
-  {
-    std::cout << "Listening to port " << port << std::endl;
+  if (n_threads <= 1) {
+    return runHub(config, port, 0);
   }
-  else
-  {
-    std::cerr << "Failed to listen to port" << std::endl;
-    return -1;
+
+  // one event loop per thread, the kernel spreads new connections over the
+  // listening sockets
+  std::cout << "[Info] Starting " << n_threads << " event loops" << std::endl;
+  std::vector<std::thread> loops;
+  for (int i = 0; i < n_threads; i++) {
+    Handler thread_config = config;
+    thread_config.recorder = recorders[i].get();
+    thread_config.frame_recorder = frame_recorders[i].get();
+    loops.emplace_back([thread_config, port, i] {
+      pinToCore(i);
+      runHub(thread_config, port, uS::ListenOptions::REUSE_PORT);
+    });
   }
-  h.run();
+  for (auto &t : loops) {
+    t.join();
+  }
+  return 0;
 }
@@ -0,0 +1,263 @@
+#include "metrics.h"
+#include <algorithm>
+#include <cinttypes>
+#include <cstdarg>
+#include <cstdio>
+#include <mutex>
+#include <vector>
+#include "gains.h"
+#include "json.hpp"
+#include "latency.h"
+#include "logger.h"
+#include "timing.h"
+
+// for convenience
+using json = nlohmann::json;
+
+SessionStats::SessionStats() : id(0), connected_ns(0), frames(0), telemetry(0),
+                               manual(0), dropped(0), gain_version(0), twiddle_iter(0), best_sse(0), sse(0) {
+    for (int i = 0; i < 3; i++) {
+        gain[i].store(0, std::memory_order_relaxed);
+    }
+}
+
+static std::mutex                                 g_session_lock;
+static std::vector<std::shared_ptr<SessionStats>> g_sessions;
+static uint64_t                                   g_next_id = 1;
+static const uint64_t                             g_start_ns = nowNs();
+
+// counters of closed connections
+static std::atomic<uint64_t> g_closed_frames(0);
+static std::atomic<uint64_t> g_closed_telemetry(0);
+static std::atomic<uint64_t> g_closed_manual(0);
+static std::atomic<uint64_t> g_closed_dropped(0);
+static std::atomic<uint64_t> g_closed_sessions(0);
+
+std::shared_ptr<SessionStats> openSession() {
+    std::shared_ptr<SessionStats> session(new SessionStats());
+    session->connected_ns = nowNs();
+    std::lock_guard<std::mutex> lock(g_session_lock);
+    session->id = g_next_id++;
+    g_sessions.push_back(session);
+    return session;
+}
+
+void closeSession(const std::shared_ptr<SessionStats> &session) {
+    if (!session) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(g_session_lock);
+        g_sessions.erase(std::remove(g_sessions.begin(), g_sessions.end(), session), g_sessions.end());
+    }
+    g_closed_frames.fetch_add(session->frames.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    g_closed_telemetry.fetch_add(session->telemetry.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    g_closed_manual.fetch_add(session->manual.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    g_closed_dropped.fetch_add(session->dropped.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    g_closed_sessions.fetch_add(1, std::memory_order_relaxed);
+}
+
+/*
+* Consistent enough copy of everything a scrape reports. Live sessions are
+* kept alive by the copied pointers, so the lock is held only for the copy.
+*/
+struct Scrape {
+  std::vector<std::shared_ptr<SessionStats>> sessions;
+  HistogramSnapshot latency[STAGE_COUNT];
+  uint64_t frames;
+  uint64_t telemetry;
+  uint64_t manual;
+  uint64_t dropped;
+  uint64_t closed_sessions;
+  uint64_t log_dropped;
+  uint64_t gain_version;
+  uint64_t now_ns;
+
+  Scrape() {
+      {
+          std::lock_guard<std::mutex> lock(g_session_lock);
+          sessions = g_sessions;
+      }
+      frames          = g_closed_frames.load(std::memory_order_relaxed);
+      telemetry       = g_closed_telemetry.load(std::memory_order_relaxed);
+      manual          = g_closed_manual.load(std::memory_order_relaxed);
+      dropped         = g_closed_dropped.load(std::memory_order_relaxed);
+      closed_sessions = g_closed_sessions.load(std::memory_order_relaxed);
+      for (const auto &s : sessions) {
+          frames    += s->frames.load(std::memory_order_relaxed);
+          telemetry += s->telemetry.load(std::memory_order_relaxed);
+          manual    += s->manual.load(std::memory_order_relaxed);
+          dropped   += s->dropped.load(std::memory_order_relaxed);
+      }
+      log_dropped = logDropped();
+      gain_version = currentGainVersion();
+      snapshotStageLatency(latency);
+      now_ns = nowNs();
+  }
+};
+
+static const char *kGainName[3] = {"kp", "ki", "kd"};
+
+static void appendf(std::string &out, const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+
+static void appendf(std::string &out, const char *fmt, ...) {
+    char line[256];
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(line, sizeof(line), fmt, ap);
+    va_end(ap);
+    if (n > 0) {
+        out.append(line, std::min<size_t>(n, sizeof(line) - 1));
+    }
+}
+
+static void appendHeader(std::string &out, const char *name, const char *type, const char *help) {
+    appendf(out, "# HELP %s %s\n# TYPE %s %s\n", name, help, name, type);
+}
+
+std::string metricsText() {
+    Scrape s;
+    std::string out;
+    out.reserve(4096 + s.sessions.size() * 1024);
+
+    appendHeader(out, "pid_uptime_seconds", "gauge", "Seconds since the process started.");
+    appendf(out, "pid_uptime_seconds %.3f\n", (s.now_ns - g_start_ns) * 1e-9);
+    appendHeader(out, "pid_frames_total", "counter", "Frames received from simulators.");
+    appendf(out, "pid_frames_total %" PRIu64 "\n", s.frames);
+    appendHeader(out, "pid_telemetry_frames_total", "counter", "Telemetry frames answered with a steer message.");
+    appendf(out, "pid_telemetry_frames_total %" PRIu64 "\n", s.telemetry);
+    appendHeader(out, "pid_manual_frames_total", "counter", "Frames without data, answered with manual.");
+    appendf(out, "pid_manual_frames_total %" PRIu64 "\n", s.manual);
+    appendHeader(out, "pid_frames_dropped_total", "counter", "Frames that were not a SocketIO event or carried no usable telemetry.");
+    appendf(out, "pid_frames_dropped_total %" PRIu64 "\n", s.dropped);
+    appendHeader(out, "pid_log_records_dropped_total", "counter", "Log records dropped because a log queue was full.");
+    appendf(out, "pid_log_records_dropped_total %" PRIu64 "\n", s.log_dropped);
+    appendHeader(out, "pid_gain_version", "gauge", "Latest published gain set, 0 while the command line gains are in use.");
+    appendf(out, "pid_gain_version %" PRIu64 "\n", s.gain_version);
+    appendHeader(out, "pid_sessions", "gauge", "Connected simulators.");
+    appendf(out, "pid_sessions %zu\n", s.sessions.size());
+    appendHeader(out, "pid_sessions_closed_total", "counter", "Simulator connections closed.");
+    appendf(out, "pid_sessions_closed_total %" PRIu64 "\n", s.closed_sessions);
+
+    appendHeader(out, "pid_stage_latency_seconds", "summary", "Time spent in each stage of handling a telemetry frame.");
+    static const double quantile[] = {0.5, 0.99, 0.999};
+    for (int st = 0; st < STAGE_COUNT; st++) {
+        const HistogramSnapshot &h = s.latency[st];
+        for (double q : quantile) {
+            appendf(out, "pid_stage_latency_seconds{stage=\"%s\",quantile=\"%g\"} %.9f\n",
+                    kStageName[st], q, h.Percentile(q) * 1e-9);
+        }
+        appendf(out, "pid_stage_latency_seconds_sum{stage=\"%s\"} %.9f\n", kStageName[st], h.sum * 1e-9);
+        appendf(out, "pid_stage_latency_seconds_count{stage=\"%s\"} %" PRIu64 "\n", kStageName[st], h.total);
+    }
+    appendHeader(out, "pid_stage_latency_max_seconds", "gauge", "Longest time spent in each stage.");
+    for (int st = 0; st < STAGE_COUNT; st++) {
+        appendf(out, "pid_stage_latency_max_seconds{stage=\"%s\"} %.9f\n", kStageName[st], s.latency[st].max * 1e-9);
+    }
+
+    appendHeader(out, "pid_session_frames_total", "counter", "Frames received on a connection.");
+    for (const auto &ss : s.sessions) {
+        appendf(out, "pid_session_frames_total{session=\"%" PRIu64 "\"} %" PRIu64 "\n",
+                ss->id, ss->frames.load(std::memory_order_relaxed));
+    }
+    appendHeader(out, "pid_session_uptime_seconds", "gauge", "Seconds since a connection was opened.");
+    for (const auto &ss : s.sessions) {
+        appendf(out, "pid_session_uptime_seconds{session=\"%" PRIu64 "\"} %.3f\n",
+                ss->id, (s.now_ns - ss->connected_ns) * 1e-9);
+    }
+    appendHeader(out, "pid_session_telemetry_frames_total", "counter", "Telemetry frames steered on a connection.");
+    for (const auto &ss : s.sessions) {
+        appendf(out, "pid_session_telemetry_frames_total{session=\"%" PRIu64 "\"} %" PRIu64 "\n",
+                ss->id, ss->telemetry.load(std::memory_order_relaxed));
+    }
+    appendHeader(out, "pid_session_manual_frames_total", "counter", "Frames without data answered with manual on a connection.");
+    for (const auto &ss : s.sessions) {
+        appendf(out, "pid_session_manual_frames_total{session=\"%" PRIu64 "\"} %" PRIu64 "\n",
+                ss->id, ss->manual.load(std::memory_order_relaxed));
+    }
+    appendHeader(out, "pid_session_frames_dropped_total", "counter", "Frames dropped on a connection.");
+    for (const auto &ss : s.sessions) {
+        appendf(out, "pid_session_frames_dropped_total{session=\"%" PRIu64 "\"} %" PRIu64 "\n",
+                ss->id, ss->dropped.load(std::memory_order_relaxed));
+    }
+    appendHeader(out, "pid_session_gain", "gauge", "Steering PID gains in use on a connection.");
+    for (const auto &ss : s.sessions) {
+        for (int i = 0; i < 3; i++) {
+            appendf(out, "pid_session_gain{session=\"%" PRIu64 "\",term=\"%s\"} %.9g\n",
+                    ss->id, kGainName[i], ss->gain[i].load(std::memory_order_relaxed));
+        }
+    }
+    appendHeader(out, "pid_session_gain_version", "gauge", "Published gain set in use on a connection.");
+    for (const auto &ss : s.sessions) {
+        appendf(out, "pid_session_gain_version{session=\"%" PRIu64 "\"} %" PRIu64 "\n",
+                ss->id, ss->gain_version.load(std::memory_order_relaxed));
+    }
+    appendHeader(out, "pid_session_twiddle_iteration", "gauge", "Twiddle iterations done on a connection.");
+    for (const auto &ss : s.sessions) {
+        appendf(out, "pid_session_twiddle_iteration{session=\"%" PRIu64 "\"} %d\n",
+                ss->id, ss->twiddle_iter.load(std::memory_order_relaxed));
+    }
+    appendHeader(out, "pid_session_twiddle_best_sse", "gauge", "Best twiddle episode cost on a connection.");
+    for (const auto &ss : s.sessions) {
+        appendf(out, "pid_session_twiddle_best_sse{session=\"%" PRIu64 "\"} %.9g\n",
+                ss->id, ss->best_sse.load(std::memory_order_relaxed));
+    }
+    appendHeader(out, "pid_session_twiddle_sse", "gauge", "Cost of the current twiddle episode so far on a connection.");
+    for (const auto &ss : s.sessions) {
+        appendf(out, "pid_session_twiddle_sse{session=\"%" PRIu64 "\"} %.9g\n",
+                ss->id, ss->sse.load(std::memory_order_relaxed));
+    }
+    return out;
+}
+
+std::string statsJson() {
+    Scrape s;
+    json stats;
+    stats["uptime_s"]    = (s.now_ns - g_start_ns) * 1e-9;
+    stats["frames"]      = s.frames;
+    stats["telemetry"]   = s.telemetry;
+    stats["manual"]      = s.manual;
+    stats["dropped"]     = s.dropped;
+    stats["log_dropped"] = s.log_dropped;
+    stats["gain_version"] = s.gain_version;
+    stats["sessions_closed"] = s.closed_sessions;
+
+    json latency = json::object();
+    for (int st = 0; st < STAGE_COUNT; st++) {
+        const HistogramSnapshot &h = s.latency[st];
+        latency[kStageName[st]] = {
+            {"count", h.total},
+            {"sum",   h.sum},
+            {"p50",   h.Percentile(0.5)},
+            {"p99",   h.Percentile(0.99)},
+            {"p999",  h.Percentile(0.999)},
+            {"max",   h.max}
+        };
+    }
+    stats["latency_ns"] = latency;
+
+    json sessions = json::array();
+    for (const auto &ss : s.sessions) {
+        json gain;
+        for (int i = 0; i < 3; i++) {
+            gain[kGainName[i]] = ss->gain[i].load(std::memory_order_relaxed);
+        }
+        sessions.push_back({
+            {"id",        ss->id},
+            {"uptime_s",  (s.now_ns - ss->connected_ns) * 1e-9},
+            {"frames",    ss->frames.load(std::memory_order_relaxed)},
+            {"telemetry", ss->telemetry.load(std::memory_order_relaxed)},
+            {"manual",    ss->manual.load(std::memory_order_relaxed)},
+            {"dropped",   ss->dropped.load(std::memory_order_relaxed)},
+            {"gain",      gain},
+            {"gain_version", ss->gain_version.load(std::memory_order_relaxed)},
+            {"twiddle",   {
+                {"iteration", ss->twiddle_iter.load(std::memory_order_relaxed)},
+                {"best_sse",  ss->best_sse.load(std::memory_order_relaxed)},
+                {"sse",       ss->sse.load(std::memory_order_relaxed)}
+            }}
+        });
+    }
+    stats["sessions"] = sessions;
+    return stats.dump();
+}
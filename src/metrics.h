@@ -0,0 +1,57 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+/*
+* Counters of one simulator connection. Only the event loop owning the
+* connection writes them, with relaxed loads and stores, so the message path
+* never takes a lock or a locked instruction. HTTP scrapes read them from any
+* thread.
+*/
+struct SessionStats {
+  uint64_t              id;
+  uint64_t              connected_ns;
+  std::atomic<uint64_t> frames;        // every received frame
+  std::atomic<uint64_t> telemetry;     // telemetry handled and steer sent
+  std::atomic<uint64_t> manual;        // manual driving, no data
+  std::atomic<uint64_t> dropped;       // not an event or no usable telemetry
+  std::atomic<double>   gain[3];       // kp, ki, kd in use
+  std::atomic<uint64_t> gain_version;  // published gain set in use, 0: command line
+  std::atomic<int>      twiddle_iter;
+  std::atomic<double>   best_sse;
+  std::atomic<double>   sse;           // cost accumulated in the current episode
+
+  SessionStats();
+};
+
+inline void statInc(std::atomic<uint64_t> &counter) {
+  counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+}
+
+/*
+* Register a new connection, the registry lock is only taken here, in
+* closeSession() and for the list copy of a scrape.
+*/
+std::shared_ptr<SessionStats> openSession();
+
+/*
+* Fold the counters of a closed connection into the process totals and
+* unregister it.
+*/
+void closeSession(const std::shared_ptr<SessionStats> &session);
+
+/*
+* Prometheus text exposition, served on /metrics.
+*/
+std::string metricsText();
+
+/*
+* The same values as a JSON document, served on /stats.
+*/
+std::string statsJson();
+
+#endif /* METRICS_H */
@@ -0,0 +1,63 @@
+#include "parallel_twiddle.h"
+
+static double evaluate(const VehicleSim &proto, const float gain[3], int n_steps, double abort_sse,
+                       const SpeedControl *speed, const PID &steer) {
+    VehicleSim sim(proto);
+    PID pid = steer;
+    pid.Init(gain[0], gain[1], gain[2]);
+    if (speed == nullptr) {
+        return runEpisode(sim, pid, n_steps, abort_sse);
+    }
+    SpeedControl episode_speed = *speed;
+    return runEpisode(sim, pid, n_steps, abort_sse, &episode_speed);
+}
+
+TwiddleResult parallelTwiddle(const VehicleSim &sim, const float gain[3], const float d_gain[3],
+                              int n_steps, float tol, ThreadPool &pool,
+                              const SpeedControl *speed, const PID &steer) {
+    TwiddleResult res;
+    for (int i = 0; i < 3; i++) {
+        res.gain[i]   = gain[i];
+        res.d_gain[i] = d_gain[i];
+    }
+    res.best_sse = evaluate(sim, res.gain, n_steps, 1e300, speed, steer);
+    res.rounds   = 0;
+    res.episodes = 1;
+
+    // probe 2 * i is gain i + d, probe 2 * i + 1 is gain i - d
+    float  probe[6][3];
+    double sse[6];
+    while (res.d_gain[0] + res.d_gain[1] + res.d_gain[2] >= tol) {
+        const double bound = res.best_sse;
+        for (int k = 0; k < 6; k++) {
+            int i = k / 2;
+            for (int j = 0; j < 3; j++) probe[k][j] = res.gain[j];
+            probe[k][i] += (k % 2 == 0) ? res.d_gain[i] : -res.d_gain[i];
+            pool.Submit([&sim, &probe, &sse, k, n_steps, bound, speed, &steer] {
+                sse[k] = evaluate(sim, probe[k], n_steps, bound, speed, steer);
+            });
+        }
+        pool.Wait();
+        res.episodes += 6;
+        res.rounds++;
+
+        int best = -1;
+        for (int k = 0; k < 6; k++) {
+            if (sse[k] < res.best_sse && (best < 0 || sse[k] < sse[best])) {
+                best = k;
+            }
+        }
+        for (int i = 0; i < 3; i++) {
+            bool improved = sse[2 * i] < res.best_sse || sse[2 * i + 1] < res.best_sse;
+            if (!improved) {
+                res.d_gain[i] *= 0.9;
+            }
+        }
+        if (best >= 0) {
+            for (int j = 0; j < 3; j++) res.gain[j] = probe[best][j];
+            res.best_sse = sse[best];
+            res.d_gain[best / 2] *= 1.1;
+        }
+    }
+    return res;
+}
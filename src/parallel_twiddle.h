@@ -0,0 +1,30 @@
+#ifndef PARALLEL_TWIDDLE_H
+#define PARALLEL_TWIDDLE_H
+
+#include "sim.h"
+#include "thread_pool.h"
+
+struct TwiddleResult {
+  float  gain[3];      // best gain, convention Kp, Ki, Kd
+  float  d_gain[3];    // step sizes when the search stopped
+  double best_sse;
+  int    rounds;
+  int    episodes;
+};
+
+/*
+* Twiddle that evaluates the +d and -d probes of all three gains at once,
+* one simulator episode per pool task. After each round the best improving
+* probe is taken and its step grows by 10%, gains where neither probe
+* improved shrink their step by 10%, like the serial TwiddleTuner. The
+* result does not depend on the number of threads. Every episode runs on
+* its own copy of sim and, with speed, drives the throttle with its own
+* copy of that speed controller. The steering controller is a copy of
+* steer with the probe gains, so it keeps its derivative filter and form.
+*/
+TwiddleResult parallelTwiddle(const VehicleSim &sim, const float gain[3], const float d_gain[3],
+                              int n_steps, float tol, ThreadPool &pool,
+                              const SpeedControl *speed = nullptr,
+                              const PID &steer = PID());
+
+#endif /* PARALLEL_TWIDDLE_H */
@@ -0,0 +1,127 @@
+#include "pid_bank.h"
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define PID_BANK_X86 1
+#endif
+
+static const size_t kLanes = 8;   // one cache line of doubles
+
+PidBank::PidBank(size_t n) : n(n) {
+    padded = (n + kLanes - 1) / kLanes * kLanes;
+    void *mem = nullptr;
+    if (posix_memalign(&mem, 64, 6 * padded * sizeof(double)) != 0) {
+        throw std::bad_alloc();
+    }
+    storage = static_cast<double *>(mem);
+    memset(storage, 0, 6 * padded * sizeof(double));
+    p_error = storage;
+    i_error = storage + padded;
+    d_error = storage + 2 * padded;
+    Kp      = storage + 3 * padded;
+    Ki      = storage + 4 * padded;
+    Kd      = storage + 5 * padded;
+    isa     = BestIsa();
+}
+
+PidBank::~PidBank() {
+    free(storage);
+}
+
+void PidBank::Init(size_t i, double kp, double ki, double kd) {
+    p_error[i] = 0;
+    i_error[i] = 0;
+    d_error[i] = 0;
+    Kp[i] = kp;
+    Ki[i] = ki;
+    Kd[i] = kd;
+}
+
+static void stepScalar(PidBank &bank, size_t begin, size_t end, const double *cte, double *out) {
+    for (size_t k = begin; k < end; k++) {
+        double c = cte[k];
+        bank.d_error[k] = c - bank.p_error[k];
+        bank.i_error[k] += c;
+        bank.p_error[k] = c;
+        out[k] = (-bank.Kp[k] * bank.p_error[k]) + (-bank.Kd[k] * bank.d_error[k]) +
+                 (-bank.Ki[k] * bank.i_error[k]);
+    }
+}
+
+#ifdef PID_BANK_X86
+__attribute__((target("sse2")))
+static size_t stepSse2(PidBank &bank, size_t n, const double *cte, double *out) {
+    const __m128d sign = _mm_set1_pd(-0.0);
+    size_t k = 0;
+    for (; k + 2 <= n; k += 2) {
+        __m128d c  = _mm_loadu_pd(cte + k);
+        __m128d p  = _mm_load_pd(bank.p_error + k);
+        __m128d i  = _mm_add_pd(_mm_load_pd(bank.i_error + k), c);
+        __m128d d  = _mm_sub_pd(c, p);
+        _mm_store_pd(bank.d_error + k, d);
+        _mm_store_pd(bank.i_error + k, i);
+        _mm_store_pd(bank.p_error + k, c);
+        __m128d kp = _mm_xor_pd(_mm_load_pd(bank.Kp + k), sign);
+        __m128d ki = _mm_xor_pd(_mm_load_pd(bank.Ki + k), sign);
+        __m128d kd = _mm_xor_pd(_mm_load_pd(bank.Kd + k), sign);
+        __m128d u  = _mm_add_pd(_mm_add_pd(_mm_mul_pd(kp, c), _mm_mul_pd(kd, d)), _mm_mul_pd(ki, i));
+        _mm_storeu_pd(out + k, u);
+    }
+    return k;
+}
+
+__attribute__((target("avx2")))
+static size_t stepAvx2(PidBank &bank, size_t n, const double *cte, double *out) {
+    const __m256d sign = _mm256_set1_pd(-0.0);
+    size_t k = 0;
+    for (; k + 4 <= n; k += 4) {
+        __m256d c  = _mm256_loadu_pd(cte + k);
+        __m256d p  = _mm256_load_pd(bank.p_error + k);
+        __m256d i  = _mm256_add_pd(_mm256_load_pd(bank.i_error + k), c);
+        __m256d d  = _mm256_sub_pd(c, p);
+        _mm256_store_pd(bank.d_error + k, d);
+        _mm256_store_pd(bank.i_error + k, i);
+        _mm256_store_pd(bank.p_error + k, c);
+        __m256d kp = _mm256_xor_pd(_mm256_load_pd(bank.Kp + k), sign);
+        __m256d ki = _mm256_xor_pd(_mm256_load_pd(bank.Ki + k), sign);
+        __m256d kd = _mm256_xor_pd(_mm256_load_pd(bank.Kd + k), sign);
+        __m256d u  = _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(kp, c), _mm256_mul_pd(kd, d)),
+                                   _mm256_mul_pd(ki, i));
+        _mm256_storeu_pd(out + k, u);
+    }
+    return k;
+}
+#endif
+
+void PidBank::Step(const double *cte, double *out) {
+    size_t done = 0;
+#ifdef PID_BANK_X86
+    if (isa == BANK_AVX2) {
+        done = stepAvx2(*this, n, cte, out);
+    } else if (isa == BANK_SSE2) {
+        done = stepSse2(*this, n, cte, out);
+    }
+#endif
+    // tail, or everything without SIMD
+    stepScalar(*this, done, n, cte, out);
+}
+
+BANK_ISA PidBank::BestIsa() {
+#ifdef PID_BANK_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) return BANK_AVX2;
+    if (__builtin_cpu_supports("sse2")) return BANK_SSE2;
+#endif
+    return BANK_SCALAR;
+}
+
+const char *PidBank::IsaName(BANK_ISA isa) {
+    switch (isa) {
+        case BANK_AVX2: return "avx2";
+        case BANK_SSE2: return "sse2";
+        default:        return "scalar";
+    }
+}
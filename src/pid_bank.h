@@ -0,0 +1,63 @@
+#ifndef PID_BANK_H
+#define PID_BANK_H
+
+#include <cstddef>
+
+enum BANK_ISA
+{
+    BANK_SCALAR = 0,
+    BANK_SSE2,      // 2 controllers per instruction
+    BANK_AVX2       // 4 controllers per instruction
+};
+
+/*
+* Many independent PID controllers stepped together, e.g. a fleet of
+* simulated cars or a twiddle population. Error terms and gains are kept as
+* separate 64-byte aligned arrays (structure of arrays) so one call updates
+* N controllers with SIMD. Each lane does exactly the operations of
+* PID::UpdateError() + PID::TotalError() in the same order without fused
+* multiply-add, so the outputs match PID bit for bit.
+*/
+class PidBank {
+public:
+  double *p_error;
+  double *i_error;
+  double *d_error;
+  double *Kp;
+  double *Ki;
+  double *Kd;
+  BANK_ISA isa;    // widest instruction set of this CPU by default
+
+  explicit PidBank(size_t n);
+  ~PidBank();
+
+  size_t Size() const { return n; }
+
+  /*
+  * Set the gains of controller i and clear its errors.
+  */
+  void Init(size_t i, double kp, double ki, double kd);
+
+  /*
+  * Update every controller with its cte and write its steering value,
+  * both arrays hold Size() values.
+  */
+  void Step(const double *cte, double *out);
+
+  /*
+  * Widest instruction set supported by the CPU running this.
+  */
+  static BANK_ISA BestIsa();
+
+  static const char *IsaName(BANK_ISA isa);
+
+private:
+  size_t  n;
+  size_t  padded;   // n rounded up to the SIMD width, lanes past n are zero
+  double *storage;
+
+  PidBank(const PidBank &) = delete;
+  PidBank &operator=(const PidBank &) = delete;
+};
+
+#endif /* PID_BANK_H */
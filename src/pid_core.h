@@ -0,0 +1,323 @@
+#ifndef PID_CORE_H
+#define PID_CORE_H
+
+#include <algorithm>
+#include <cmath>
+#include <ratio>
+#include <string>
+
+enum WINDUP
+{
+    WINDUP_NONE = 0,     // output is limited, the integral is not
+    WINDUP_CLAMP,        // integral term limited to the output range
+    WINDUP_BACK_CALC,    // integral pulled back by kb times the saturation excess
+    WINDUP_CONDITIONAL   // no integration while it would push further into saturation
+};
+
+/*
+* Output range and anti-windup strategy for BasicPid::UpdateLimited().
+*/
+template <typename T>
+struct PidLimits {
+  T      out_min;
+  T      out_max;
+  WINDUP windup;
+  T      kb;         // back-calculation gain, 1 removes the whole excess
+
+  PidLimits() : out_min(T(-1)), out_max(T(1)), windup(WINDUP_NONE), kb(T(1)) {}
+};
+
+enum DFILTER
+{
+    DFILTER_NONE = 0,    // raw difference
+    DFILTER_LOWPASS,     // first-order low-pass
+    DFILTER_BIQUAD       // second-order Butterworth low-pass
+};
+
+/*
+* Low-pass on the derivative term and derivative-on-measurement. Both
+* filters run as the same transposed direct form II recurrence with two
+* state values, the first-order one just has b1 = b2 = a2 = 0. cutoff is a
+* fraction of the update rate, below the Nyquist limit of 0.5. The state is
+* cleared by Reset() and starts from zero, so a step in the first frames is
+* ramped in as well.
+*/
+template <typename T>
+struct DerivFilter {
+  DFILTER type;
+  bool    on_measurement;  // difference of the measurement instead of the error
+  bool    is_primed;       // a measurement was taken since Reset()
+  T       b0, b1, b2;
+  T       a1, a2;
+  T       z1, z2;
+
+  DerivFilter() : type(DFILTER_NONE), on_measurement(false) {
+    Set(DFILTER_NONE, T(0));
+  }
+
+  bool IsOn() const { return type != DFILTER_NONE || on_measurement; }
+
+  static bool IsValidCutoff(T cutoff) { return cutoff > T(0) && cutoff < T(0.5); }
+
+  void Set(DFILTER t, T cutoff) {
+    type = t;
+    b0 = T(1);
+    b1 = b2 = a1 = a2 = T(0);
+    if (t == DFILTER_LOWPASS) {
+      T alpha = T(1) - std::exp(T(-2 * M_PI) * cutoff);
+      b0 = alpha;
+      a1 = alpha - T(1);
+    } else if (t == DFILTER_BIQUAD) {
+      const T q = T(M_SQRT1_2);
+      T k = std::tan(T(M_PI) * cutoff);
+      T norm = T(1) / (T(1) + k / q + k * k);
+      b0 = k * k * norm;
+      b1 = T(2) * b0;
+      b2 = b0;
+      a1 = T(2) * (k * k - T(1)) * norm;
+      a2 = (T(1) - k / q + k * k) * norm;
+    }
+    Reset();
+  }
+
+  void Reset() {
+    z1 = z2 = T(0);
+    is_primed = false;
+  }
+
+  /*
+  * Raw difference for this step. The steering setpoint is the centerline,
+  * so the measurement is the cte itself, prev_err is the last one, and
+  * on_measurement differs from the error difference only after a reset:
+  * it starts from the first measurement instead of from zero, which
+  * removes the derivative kick of the first step.
+  */
+  T Difference(T err, T prev_err) {
+    T d = err - prev_err;
+    if (on_measurement) {
+      d = is_primed ? d : T(0);
+      is_primed = true;
+    }
+    return d;
+  }
+
+  T Apply(T x) {
+    T y = b0 * x + z1;
+    z1 = b1 * x - a1 * y + z2;
+    z2 = b2 * x - a2 * y;
+    return y;
+  }
+};
+
+/*
+* Filter type from its command line name: none, lowpass or biquad.
+*/
+inline bool parseDFilter(const std::string &name, DFILTER &type) {
+  if (name == "none") {
+    type = DFILTER_NONE;
+  } else if (name == "lowpass") {
+    type = DFILTER_LOWPASS;
+  } else if (name == "biquad") {
+    type = DFILTER_BIQUAD;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+/*
+* Header-only PID core, the per-step update and output are inline and
+* branch-free. T is the precision policy: float, double, or any type with
+* the arithmetic operators, e.g. a fixed-point number. Trivially
+* constructible so controllers can live in arrays, call Init() before use.
+*/
+template <typename T>
+struct BasicPid {
+  T p_error;
+  T i_error;
+  T d_error;
+
+  T Kp;
+  T Ki;
+  T Kd;
+
+  T u;       // running output of the velocity form
+
+  /*
+  * Set the gains and clear the errors.
+  */
+  void Init(T kp, T ki, T kd) {
+    p_error = T(0);
+    i_error = T(0);
+    d_error = T(0);
+    u = T(0);
+    Kp = kp;
+    Ki = ki;
+    Kd = kd;
+  }
+
+  /*
+  * Update the error terms with the cross track error of this step.
+  */
+  void Update(T cte) {
+    d_error = cte - p_error;
+    i_error += cte;
+    p_error = cte;
+  }
+
+  /*
+  * Update with the elapsed time as a multiple of the nominal step the gains
+  * were tuned at: the difference is divided by it and the integral grows by
+  * cte times it. A scale of 1 gives exactly Update(cte).
+  */
+  void Update(T cte, T dt_scale) {
+    d_error = (cte - p_error) / dt_scale;
+    i_error += cte * dt_scale;
+    p_error = cte;
+  }
+
+  /*
+  * Update(cte, dt_scale) with the derivative taken and filtered by f.
+  */
+  void Update(T cte, T dt_scale, DerivFilter<T> &f) {
+    d_error = f.Apply(f.Difference(cte, p_error) / dt_scale);
+    i_error += cte * dt_scale;
+    p_error = cte;
+  }
+
+  /*
+  * Velocity (incremental) form of Update(cte, dt_scale): instead of summing
+  * cte into i_error, u moves by the change of the output at the current
+  * gains, -(Kp*dp + Ki*cte*dt_scale + Kd*dd). The accumulated value stays
+  * on the scale of the output, and with constant gains u follows Output()
+  * up to rounding. A gain change only applies to the following increments,
+  * so switching gains mid-run does not step the output. i_error stays as is.
+  */
+  void UpdateVelocity(T cte, T dt_scale) {
+    T p_prev = p_error;
+    T d_prev = d_error;
+    d_error = (cte - p_error) / dt_scale;
+    p_error = cte;
+    u -= Kp * (p_error - p_prev) + Ki * cte * dt_scale + Kd * (d_error - d_prev);
+  }
+
+  void UpdateVelocity(T cte, T dt_scale, DerivFilter<T> &f) {
+    T p_prev = p_error;
+    T d_prev = d_error;
+    d_error = f.Apply(f.Difference(cte, p_error) / dt_scale);
+    p_error = cte;
+    u -= Kp * (p_error - p_prev) + Ki * cte * dt_scale + Kd * (d_error - d_prev);
+  }
+
+  /*
+  * Steering value, (-Kp*p_error) + (-Kd*d_error) + (-Ki*i_error).
+  */
+  T Output() const {
+    return (-Kp * p_error) + (-Kd * d_error) + (-Ki * i_error);
+  }
+
+  /*
+  * Update(cte, dt_scale) and Output() with the output limited to the range
+  * and the integral protected from windup. The strategy is the same on
+  * every step, so its switch is always predicted; inside, limits are taken
+  * with min/max and selects rather than data-dependent branches.
+  */
+  T UpdateLimited(T cte, T dt_scale, const PidLimits<T> &lim) {
+    T i_prev = i_error;
+    Update(cte, dt_scale);
+    return Limit(i_prev, lim);
+  }
+
+  T UpdateLimited(T cte, T dt_scale, const PidLimits<T> &lim, DerivFilter<T> &f) {
+    T i_prev = i_error;
+    Update(cte, dt_scale, f);
+    return Limit(i_prev, lim);
+  }
+
+  /*
+  * Anti-windup and output limits after an update, i_prev is the integral
+  * before it.
+  */
+  T Limit(T i_prev, const PidLimits<T> &lim) {
+    T inv_ki = Ki != T(0) ? T(1) / Ki : T(0);
+    switch (lim.windup) {
+      case WINDUP_CLAMP: {
+        T bound = std::max(std::abs(lim.out_min), std::abs(lim.out_max)) * std::abs(inv_ki);
+        i_error = std::min(std::max(i_error, -bound), bound);
+        break;
+      }
+      case WINDUP_BACK_CALC: {
+        T u = Output();
+        T u_sat = std::min(std::max(u, lim.out_min), lim.out_max);
+        i_error -= lim.kb * (u_sat - u) * inv_ki;
+        break;
+      }
+      case WINDUP_CONDITIONAL: {
+        T u = Output();
+        T push = -Ki * (i_error - i_prev);   // output change from this integration
+        bool hold = (u > lim.out_max && push > T(0)) | (u < lim.out_min && push < T(0));
+        i_error = hold ? i_prev : i_error;
+        break;
+      }
+      default:
+        break;
+    }
+    return std::min(std::max(Output(), lim.out_min), lim.out_max);
+  }
+};
+
+/*
+* dt / dt_ref limited to [1/clamp, clamp], so a stalled or bunched frame
+* can neither blow up the derivative nor dump a long gap into the integral.
+*/
+template <typename T>
+inline T clampedDtScale(T dt, T dt_ref, T clamp) {
+  return std::min(std::max(dt / dt_ref, T(1) / clamp), clamp);
+}
+
+/*
+* Rational gain as a compile-time constant of type T.
+*/
+template <typename T, typename R>
+constexpr T ratioValue() {
+  return T(R::num) / T(R::den);
+}
+
+/*
+* PID with the gains fixed at compile time as std::ratio, the output is
+* straight-line code with the gains folded in as constants. Same error
+* terms and results as BasicPid<T> with the same gains.
+*/
+template <typename T, typename KpR, typename KiR, typename KdR>
+struct StaticPid {
+  T p_error;
+  T i_error;
+  T d_error;
+
+  static constexpr T Kp() { return ratioValue<T, KpR>(); }
+  static constexpr T Ki() { return ratioValue<T, KiR>(); }
+  static constexpr T Kd() { return ratioValue<T, KdR>(); }
+
+  void Init() {
+    p_error = T(0);
+    i_error = T(0);
+    d_error = T(0);
+  }
+
+  void Update(T cte) {
+    d_error = cte - p_error;
+    i_error += cte;
+    p_error = cte;
+  }
+
+  T Output() const {
+    return (-Kp() * p_error) + (-Kd() * d_error) + (-Ki() * i_error);
+  }
+};
+
+/*
+* The pretuned 0.15 / 0.001 / 0.6 steering controller.
+*/
+typedef StaticPid<double, std::ratio<15, 100>, std::ratio<1, 1000>, std::ratio<6, 10>> PretunedPid;
+
+#endif /* PID_CORE_H */
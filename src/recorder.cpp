@@ -0,0 +1,179 @@
+#include "recorder.h"
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static const char kMagic[8] = {'P', 'I', 'D', 'F', 'L', 'T', '0', '1'};
+static const char kFrameMagic[8] = {'P', 'I', 'D', 'F', 'R', 'M', '0', '1'};
+
+// Create or truncate path to size bytes, map it shared and fault every page
+// in so the control loop never takes a page fault. nullptr on failure.
+static void *createMapped(const char *path, size_t size) {
+    int fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        return nullptr;
+    }
+    if (ftruncate(fd, size) != 0) {
+        close(fd);
+        return nullptr;
+    }
+
+    int flags = MAP_SHARED;
+#ifdef MAP_POPULATE
+    flags |= MAP_POPULATE;
+#endif
+    void *mem = mmap(nullptr, size, PROT_READ | PROT_WRITE, flags, fd, 0);
+    close(fd);
+    if (mem == MAP_FAILED) {
+        return nullptr;
+    }
+
+    const long page = sysconf(_SC_PAGESIZE);
+    for (size_t off = 0; off < size; off += page) {
+        static_cast<volatile char *>(mem)[off] = 0;
+    }
+    return mem;
+}
+
+// Map an existing file read-only, nullptr if it is shorter than min_size.
+static void *mapExisting(const char *path, size_t min_size, size_t &map_size) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return nullptr;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < (off_t)min_size) {
+        close(fd);
+        return nullptr;
+    }
+    void *mem = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mem == MAP_FAILED) {
+        return nullptr;
+    }
+    map_size = st.st_size;
+    return mem;
+}
+
+FlightRecorder::FlightRecorder() {
+    header   = nullptr;
+    records  = nullptr;
+    map_size = 0;
+}
+
+FlightRecorder::~FlightRecorder() {
+    Close();
+}
+
+bool FlightRecorder::Open(const char *path, size_t capacity) {
+    Close();
+    if (capacity == 0) {
+        return false;
+    }
+
+    size_t size = sizeof(FlightHeader) + capacity * sizeof(FlightRecord);
+    void *mem = createMapped(path, size);
+    if (mem == nullptr) {
+        return false;
+    }
+
+    header  = static_cast<FlightHeader *>(mem);
+    records = reinterpret_cast<FlightRecord *>(header + 1);
+    memcpy(header->magic, kMagic, sizeof(kMagic));
+    header->record_size = sizeof(FlightRecord);
+    header->capacity    = capacity;
+    header->written.store(0, std::memory_order_relaxed);
+    map_size = size;
+    return true;
+}
+
+void FlightRecorder::Close() {
+    if (header == nullptr) {
+        return;
+    }
+    msync(header, map_size, MS_SYNC);
+    munmap(header, map_size);
+    header   = nullptr;
+    records  = nullptr;
+    map_size = 0;
+}
+
+const FlightHeader *openFlightLog(const char *path, size_t &map_size) {
+    size_t size = 0;
+    void *mem = mapExisting(path, sizeof(FlightHeader), size);
+    if (mem == nullptr) {
+        return nullptr;
+    }
+
+    const FlightHeader *header = static_cast<const FlightHeader *>(mem);
+    if (memcmp(header->magic, kMagic, sizeof(kMagic)) != 0 ||
+        header->record_size != sizeof(FlightRecord) ||
+        sizeof(FlightHeader) + header->capacity * sizeof(FlightRecord) > size) {
+        munmap(mem, size);
+        return nullptr;
+    }
+    map_size = size;
+    return header;
+}
+
+FrameRecorder::FrameRecorder() {
+    header   = nullptr;
+    text     = nullptr;
+    map_size = 0;
+}
+
+FrameRecorder::~FrameRecorder() {
+    Close();
+}
+
+bool FrameRecorder::Open(const char *path, size_t capacity) {
+    Close();
+    if (capacity == 0) {
+        return false;
+    }
+
+    size_t size = sizeof(FrameHeader) + capacity;
+    void *mem = createMapped(path, size);
+    if (mem == nullptr) {
+        return false;
+    }
+
+    header = static_cast<FrameHeader *>(mem);
+    text   = reinterpret_cast<char *>(header + 1);
+    memcpy(header->magic, kFrameMagic, sizeof(kFrameMagic));
+    header->capacity = capacity;
+    header->written.store(0, std::memory_order_relaxed);
+    header->dropped.store(0, std::memory_order_relaxed);
+    map_size = size;
+    return true;
+}
+
+void FrameRecorder::Close() {
+    if (header == nullptr) {
+        return;
+    }
+    msync(header, map_size, MS_SYNC);
+    munmap(header, map_size);
+    header   = nullptr;
+    text     = nullptr;
+    map_size = 0;
+}
+
+const FrameHeader *openFrameLog(const char *path, size_t &map_size) {
+    size_t size = 0;
+    void *mem = mapExisting(path, sizeof(FrameHeader), size);
+    if (mem == nullptr) {
+        return nullptr;
+    }
+
+    const FrameHeader *header = static_cast<const FrameHeader *>(mem);
+    if (memcmp(header->magic, kFrameMagic, sizeof(kFrameMagic)) != 0 ||
+        sizeof(FrameHeader) + header->capacity > size) {
+        munmap(mem, size);
+        return nullptr;
+    }
+    map_size = size;
+    return header;
+}
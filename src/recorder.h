@@ -0,0 +1,140 @@
+#ifndef RECORDER_H
+#define RECORDER_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include "timing.h"
+
+/*
+* One control step as stored by the flight recorder, fixed layout.
+*/
+struct FlightRecord {
+  uint64_t recv_ns;               // steady clock receive timestamp
+  double   cte;
+  double   speed;
+  double   steering_angle;
+  double   d_angle;
+  double   p_error;
+  double   i_error;
+  double   d_error;
+  double   steer_value;
+  double   throttle_value;
+  int32_t  twiddle_iter;
+  int32_t  step;
+  uint32_t stage_ns[STAGE_COUNT]; // per-stage latency, see STAGE
+};
+
+/*
+* Header at the start of the ring file, records follow it.
+*/
+struct FlightHeader {
+  char                  magic[8];      // "PIDFLT01"
+  uint32_t              record_size;
+  uint32_t              reserved;
+  uint64_t              capacity;      // number of record slots
+  std::atomic<uint64_t> written;       // records written so far, slot = n % capacity
+  char                  pad[32];
+};
+
+/*
+* Binary flight recorder, appends a FlightRecord per control step to a
+* memory-mapped ring file that is sized and faulted in when opened, so
+* Write() neither blocks on I/O nor allocates. The oldest records are
+* overwritten once the ring is full.
+*/
+class FlightRecorder {
+public:
+  FlightRecorder();
+  ~FlightRecorder();
+
+  /*
+  * Create or truncate path to hold capacity records and map it.
+  */
+  bool Open(const char *path, size_t capacity);
+
+  /*
+  * Sync and unmap the file.
+  */
+  void Close();
+
+  bool IsOpen() const { return header != nullptr; }
+
+  void Write(const FlightRecord &rec) {
+    uint64_t n = header->written.load(std::memory_order_relaxed);
+    records[n % header->capacity] = rec;
+    header->written.store(n + 1, std::memory_order_release);
+  }
+
+private:
+  FlightHeader *header;
+  FlightRecord *records;
+  size_t        map_size;
+};
+
+/*
+* Map an existing ring file read-only, e.g. for dumping it.
+* Returns nullptr if the file is not a flight recorder file.
+*/
+const FlightHeader *openFlightLog(const char *path, size_t &map_size);
+
+/*
+* Header of a raw frame file, the frame text follows it.
+*/
+struct FrameHeader {
+  char                  magic[8];      // "PIDFRM01"
+  uint64_t              capacity;      // bytes of frame text
+  std::atomic<uint64_t> written;       // bytes of frame text written so far
+  std::atomic<uint64_t> dropped;       // frames that no longer fit
+  char                  pad[32];
+};
+
+/*
+* Raw frame recorder, appends every received frame byte for byte, one per
+* line, to a pre-sized memory-mapped file, the input format of pid_replay.
+* Unlike the flight ring it keeps the first frames: once the file is full
+* later frames are only counted as dropped, so the text never has a torn
+* frame at its start. Write() neither blocks on I/O nor allocates.
+*/
+class FrameRecorder {
+public:
+  FrameRecorder();
+  ~FrameRecorder();
+
+  /*
+  * Create or truncate path to hold capacity bytes of frames and map it.
+  */
+  bool Open(const char *path, size_t capacity);
+
+  /*
+  * Sync and unmap the file.
+  */
+  void Close();
+
+  bool IsOpen() const { return header != nullptr; }
+
+  void Write(const char *data, size_t length) {
+    uint64_t n = header->written.load(std::memory_order_relaxed);
+    if (length >= header->capacity - n) {
+      header->dropped.store(header->dropped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+      return;
+    }
+    memcpy(text + n, data, length);
+    text[n + length] = '\n';
+    header->written.store(n + length + 1, std::memory_order_release);
+  }
+
+private:
+  FrameHeader *header;
+  char        *text;
+  size_t       map_size;
+};
+
+/*
+* Map an existing raw frame file read-only.
+* Returns nullptr if the file is not a raw frame file.
+*/
+const FrameHeader *openFrameLog(const char *path, size_t &map_size);
+
+#endif /* RECORDER_H */
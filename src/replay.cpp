@@ -0,0 +1,170 @@
+// Drive the message handler from recorded SocketIO frames at full speed,
+// without simulator or sockets.
+//
+//   ./pid_replay [--kp=.. --ki=.. --kd=..] [--repeat=N] [--fixed] [--velocity] <frames.txt>
+//
+// frames.txt holds one raw frame per line, e.g. 42["telemetry",{...}], as
+// written by ./pid_flightlog --frames. Reports frames/sec, per-stage latency
+// percentiles and a checksum of all replies, which only depends on the input
+// and the gains and so can be compared across runs and machines. --fixed
+// also runs the cte of every frame through the fixed-point controller and
+// reports its largest deviation from the double-precision PID. --velocity
+// steers with the incremental form.
+#include <algorithm>
+#include <chrono>
+#include <cinttypes>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "args.hxx"
+#include "fixed_pid.h"
+#include "handler.h"
+#include "latency.h"
+#include "socketio.h"
+#include "telemetry.h"
+
+// 64-bit FNV-1a over every reply, in order.
+class ChecksumSink : public MessageSink {
+public:
+  uint64_t hash;
+  uint64_t messages;
+  uint64_t bytes;
+
+  ChecksumSink() : hash(14695981039346656037ULL), messages(0), bytes(0) {}
+
+  void Send(const char *data, size_t length) {
+    for (size_t i = 0; i < length; i++) {
+      hash ^= static_cast<unsigned char>(data[i]);
+      hash *= 1099511628211ULL;
+    }
+    messages++;
+    bytes += length;
+  }
+};
+
+int main(int argc, char* argv[])
+{
+    args::ArgumentParser parser("replays recorded simulator frames through the PID message handler");
+    args::HelpFlag help(parser, "help", "Display help menu", {'h', "help"});
+    args::Group gain_grp(parser, "kp, ki, kd need to coexist", args::Group::Validators::AllOrNone);
+    args::ValueFlag<float>  kp(gain_grp, "float", "proportional gain", {"kp"});
+    args::ValueFlag<float>  ki(gain_grp, "float", "integral gain", {"ki"});
+    args::ValueFlag<float>  kd(gain_grp, "float", "derivative gain", {"kd"});
+    args::ValueFlag<int>    repeat(parser, "int", "replay the file N times, default 1", {"repeat"});
+    args::Flag              fixed(parser, "fixed", "validate the fixed-point controller against the double one", {"fixed"});
+    args::Flag              velocity(parser, "velocity", "steer with the velocity (incremental) form of the PID", {"velocity"});
+    args::Positional<std::string> path(parser, "frames", "file with one SocketIO frame per line");
+
+    try
+    {
+        parser.ParseCLI(argc, argv);
+    }
+    catch (args::Help)
+    {
+        std::cout << parser;
+        return 0;
+    }
+    catch (args::ParseError e)
+    {
+        std::cerr << e.what() << std::endl;
+        std::cerr << parser;
+        return 1;
+    }
+    catch (args::ValidationError e)
+    {
+        std::cerr << e.what() << std::endl;
+        std::cerr << parser;
+        return 1;
+    }
+    if (!path) {
+        std::cerr << parser;
+        return 1;
+    }
+
+    std::vector<std::string> frames;
+    std::ifstream in(args::get(path));
+    std::string line;
+    while (std::getline(in, line)) {
+        if (!line.empty()) frames.push_back(line);
+    }
+    if (frames.empty()) {
+        std::cerr << "[Error] No frames in " << args::get(path) << std::endl;
+        return 1;
+    }
+
+    Handler handler;
+    PID &pid_steer = handler.pid_steer;
+    if (kp && ki && kd) {
+        pid_steer.Init(args::get(kp), args::get(ki), args::get(kd));
+    } else {
+        pid_steer.Init(0.15, 0.001, 0.6);
+    }
+    if (velocity) {
+        pid_steer.SetVelocity(true);
+    }
+
+    int n_repeat = repeat ? std::max(1, args::get(repeat)) : 1;
+
+    ChecksumSink sink;
+    uint64_t n_telemetry = 0;
+    auto t0 = std::chrono::steady_clock::now();
+    for (int r = 0; r < n_repeat; r++) {
+        for (const auto &f : frames) {
+            if (handler.OnMessage(f.data(), f.size(), sink) == HANDLE_TELEMETRY) {
+                n_telemetry++;
+            }
+        }
+    }
+    auto t1 = std::chrono::steady_clock::now();
+    double sec = std::chrono::duration<double>(t1 - t0).count();
+
+    uint64_t n_frames = frames.size() * n_repeat;
+    std::printf("frames: %" PRIu64 ", telemetry: %" PRIu64 ", %.3f s, %.0f frames/sec\n",
+                n_frames, n_telemetry, sec, n_frames / sec);
+    std::fflush(stdout);
+    // the handler records every telemetry step into the stage histograms
+    dumpStageLatency(std::cout);
+    std::printf("replies: %" PRIu64 ", bytes: %" PRIu64 ", checksum: %016" PRIx64 "\n",
+                sink.messages, sink.bytes, sink.hash);
+
+    if (fixed) {
+        PID ref;
+        ref.Init(pid_steer.Kp, pid_steer.Ki, pid_steer.Kd);
+        FixedSteerPid fx;
+        fx.Init(pid_steer.Kp, pid_steer.Ki, pid_steer.Kd);
+        const int frac = FixedSteerPid::kFrac;
+
+        uint64_t n_steps = 0;
+        uint64_t worst_step = 0;
+        double max_out = 0, max_p = 0, max_i = 0, max_d = 0;
+        for (const auto &f : frames) {
+            SioFrame frame;
+            Telemetry tel;
+            if (!decodeFrame(f.data(), f.size(), frame) ||
+                !(extractTelemetry(frame, tel) || parseTelemetryJson(frame, tel))) {
+                continue;
+            }
+            ref.UpdateError(tel.cte);
+            fx.Update(FixedSteerPid::ToFixed(tel.cte, frac));
+            double dev = fabs(FixedSteerPid::ToDouble(fx.Output(), frac) - ref.TotalError());
+            if (dev > max_out) {
+                max_out = dev;
+                worst_step = n_steps;
+            }
+            max_p = std::max(max_p, fabs(fx.PError() - ref.p_error));
+            max_i = std::max(max_i, fabs(fx.IError() - ref.i_error));
+            max_d = std::max(max_d, fabs(fx.DError() - ref.d_error));
+            n_steps++;
+        }
+        std::printf("fixed Q%d.%d errors, Q%d.%d gains, %d-bit integral: %" PRIu64 " steps\n",
+                    31 - FixedSteerPid::kFrac, FixedSteerPid::kFrac,
+                    31 - FixedSteerPid::kGainFrac, FixedSteerPid::kGainFrac,
+                    FixedSteerPid::kIBits, n_steps);
+        std::printf("max deviation: steer %.3g (step %" PRIu64 "), p_error %.3g, i_error %.3g, d_error %.3g\n",
+                    max_out, worst_step, max_p, max_i, max_d);
+    }
+    return 0;
+}
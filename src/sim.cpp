@@ -0,0 +1,151 @@
+#include "sim.h"
+#include <math.h>
+
+static const double kMphPerMps = 2.23694;
+
+Track Track::LakeLike() {
+    // polar loop r(phi) = r0 * (1 + a cos(2 phi) + b sin(3 phi) + c cos(5 phi)),
+    // the higher harmonics give the sharp turns
+    const int    n  = 2200;
+    const double r0 = 170.0;
+    Track t;
+    t.x.resize(n);
+    t.y.resize(n);
+    for (int i = 0; i < n; i++) {
+        double phi = 2 * M_PI * i / n;
+        double r = r0 * (1 + 0.18 * cos(2 * phi) + 0.08 * sin(3 * phi) + 0.03 * cos(5 * phi));
+        t.x[i] = r * cos(phi);
+        t.y[i] = r * sin(phi);
+    }
+    t.length = 0;
+    for (int i = 0; i < n; i++) {
+        int j = (i + 1) % n;
+        t.length += hypot(t.x[j] - t.x[i], t.y[j] - t.y[i]);
+    }
+    return t;
+}
+
+VehicleSim::VehicleSim(const Track &track) : track(track) {
+    dt              = 0.1;
+    wheelbase       = 2.67;
+    max_steer_deg   = 25.0;
+    max_accel       = 5.0;
+    drag            = 0.17;
+    road_half_width = 4.0;
+    cte_noise       = 0;
+    Reset();
+}
+
+void VehicleSim::Reset() {
+    px        = track.x[0];
+    py        = track.y[0];
+    heading   = atan2(track.y[1] - track.y[0], track.x[1] - track.x[0]);
+    v         = 0;
+    steer_deg = 0;
+    seg       = 0;
+    cte       = 0;
+    cte_reported = 0;
+    rng.seed(1);
+    noise.reset();
+}
+
+void VehicleSim::Step(double steer_value, double throttle_value) {
+    if (steer_value > 1) steer_value = 1;
+    if (steer_value < -1) steer_value = -1;
+    if (throttle_value > 1) throttle_value = 1;
+    if (throttle_value < -1) throttle_value = -1;
+
+    // positive steering turns right, i.e. clockwise
+    steer_deg = steer_value * max_steer_deg;
+    double delta = steer_deg * M_PI / 180;
+
+    px      += v * cos(heading) * dt;
+    py      += v * sin(heading) * dt;
+    heading -= v / wheelbase * tan(delta) * dt;
+    v       += (throttle_value * max_accel - drag * v) * dt;
+    if (v < 0) v = 0;
+
+    UpdateCte();
+}
+
+void VehicleSim::UpdateCte() {
+    // the car moves less than a few segments per step, search around the hint
+    const int n = track.x.size();
+    double best_d2 = 1e300;
+    int    best    = seg;
+    for (int k = -4; k <= 12; k++) {
+        int i = (seg + k + n) % n;
+        int j = (i + 1) % n;
+        double sx = track.x[j] - track.x[i];
+        double sy = track.y[j] - track.y[i];
+        double t  = ((px - track.x[i]) * sx + (py - track.y[i]) * sy) / (sx * sx + sy * sy);
+        if (t < 0) t = 0;
+        if (t > 1) t = 1;
+        double dx = px - (track.x[i] + t * sx);
+        double dy = py - (track.y[i] + t * sy);
+        double d2 = dx * dx + dy * dy;
+        if (d2 < best_d2) {
+            best_d2 = d2;
+            best    = i;
+        }
+    }
+    seg = best;
+
+    // signed distance, positive when the car is right of the driving direction
+    int j = (seg + 1) % n;
+    double sx = track.x[j] - track.x[seg];
+    double sy = track.y[j] - track.y[seg];
+    double cross = sx * (py - track.y[seg]) - sy * (px - track.x[seg]);
+    cte = -cross / hypot(sx, sy);
+    cte_reported = cte_noise > 0 ? cte + cte_noise * noise(rng) : cte;
+}
+
+Telemetry VehicleSim::Read() const {
+    Telemetry tel;
+    tel.cte            = cte_reported;
+    tel.speed          = v * kMphPerMps;
+    tel.steering_angle = steer_deg;
+    return tel;
+}
+
+bool VehicleSim::IsOffTrack() const {
+    return fabs(cte) > road_half_width;
+}
+
+double runEpisode(VehicleSim &sim, PID &pid, int n_steps, double abort_sse,
+                  SpeedControl *speed) {
+    sim.Reset();
+    pid.Init(pid.Kp, pid.Ki, pid.Kd);
+    if (speed != nullptr) {
+        speed->Reset();
+    }
+
+    double SSE = 0;
+    double previous_angle = 0;
+    for (int step = 1; ; step++) {
+        Telemetry tel = sim.Read();
+        double d_angle = previous_angle - tel.steering_angle;
+        previous_angle = tel.steering_angle;
+
+        // with a speed controller the speed gap is charged against its target,
+        // the 40 mph reference of the online cost otherwise
+        double ref_speed = speed != nullptr ? speed->target_speed : 40;
+        double cost = tel.cte * tel.cte + tel.steering_angle * tel.steering_angle +
+                      pow((ref_speed - tel.speed), 2);
+        SSE += cost;
+        if (step > n_steps || SSE > abort_sse) {
+            break;
+        }
+        if (sim.IsOffTrack()) {
+            SSE += cost * (n_steps + 1 - step);
+            break;
+        }
+
+        pid.UpdateError(tel.cte);
+        double steer_value = pid.TotalError();
+        double throttle_value = speed != nullptr ? speed->Throttle(tel.speed, steer_value)
+                                                 : 0.5 - 0.3 * fabs(d_angle);
+        sim.Step(steer_value, throttle_value);
+    }
+    return SSE;
+}
@@ -0,0 +1,86 @@
+#ifndef SIM_H
+#define SIM_H
+
+#include <random>
+#include <vector>
+#include "PID.h"
+#include "speed_control.h"
+#include "telemetry.h"
+
+/*
+* Closed track centerline as a polyline, lake track like: about 1.1 km with
+* long sweepers and a few sharp turns, driven counter-clockwise.
+*/
+struct Track {
+  std::vector<double> x;
+  std::vector<double> y;
+  double              length;
+
+  static Track LakeLike();
+};
+
+/*
+* Headless kinematic bicycle model that stands in for the Udacity simulator
+* when tuning offline. Takes the same actuations as the steer reply and
+* reports the same telemetry fields: cte in m (positive right of the
+* centerline), speed in mph and steering_angle in degrees.
+*/
+class VehicleSim {
+public:
+  double dt;              // seconds per telemetry step
+  double wheelbase;       // m
+  double max_steer_deg;   // steer_value 1.0 maps to this angle
+  double max_accel;       // m/s^2 at throttle 1.0
+  double drag;            // 1/s, speed loss proportional to speed
+  double road_half_width; // m, beyond this the car is off the road
+  double cte_noise;       // m, std deviation of the noise on the reported cte, 0: exact
+
+  VehicleSim(const Track &track);
+
+  /*
+  * Put the car at rest on the start of the centerline. The noise sequence
+  * restarts as well, so every episode sees the same noise.
+  */
+  void Reset();
+
+  /*
+  * Advance by dt with the given steer_value [-1, 1] and throttle [-1, 1].
+  */
+  void Step(double steer_value, double throttle_value);
+
+  Telemetry Read() const;
+
+  bool IsOffTrack() const;
+
+private:
+  const Track &track;
+  double       px;
+  double       py;
+  double       heading;
+  double       v;          // m/s
+  double       steer_deg;
+  int          seg;        // closest centerline segment, search hint
+  double       cte;
+  double       cte_reported;
+  std::mt19937 rng;
+  std::normal_distribution<double> noise;
+
+  void UpdateCte();
+};
+
+/*
+* One twiddle episode against the simulator, with exactly the cost and
+* actuation law of Handler::OnMessage(): SSE of cte, steering angle and
+* speed gap to 40 mph, throttle 0.5 - 0.3 * |d_angle|. The episode runs
+* until step > n_steps or SSE > abort_sse like the online twiddle. When
+* the car leaves the road the remaining steps are charged at the cost of
+* the last step. pid errors are reset with its current gains first. With
+* speed, throttle comes from that speed controller (reset first as well)
+* instead of the fixed law and the speed gap is charged against its
+* target_speed, as Handler::OnMessage() does with --speed, so each band of
+* a schedule is tuned at its own speed.
+*/
+double runEpisode(VehicleSim &sim, PID &pid, int n_steps, double abort_sse,
+                  SpeedControl *speed = nullptr);
+
+#endif /* SIM_H */
@@ -0,0 +1,64 @@
+#include "socketio.h"
+#include "strconv.h"
+
+static inline bool isSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+bool decodeFrame(const char *data, size_t length, SioFrame &frame) {
+    // "42" at the start of the message means there's a websocket message event.
+    if (length < 4 || data[0] != '4' || data[1] != '2') {
+        return false;
+    }
+
+    // event array spans from the first '[' to the last ']'
+    const char *begin = data + 2;
+    const char *end   = data + length;
+    while (begin < end && *begin != '[') begin++;
+    while (end > begin && *(end - 1) != ']') end--;
+    if (end - begin < 2) {
+        return false;
+    }
+    frame.json.data   = begin;
+    frame.json.length = end - begin;
+
+    // event name is the first element, a plain quoted string
+    const char *p    = begin + 1;
+    const char *last = end - 1;
+    while (p < last && isSpace(*p)) p++;
+    if (p == last || *p != '"') {
+        return false;
+    }
+    const char *name = ++p;
+    p = static_cast<const char *>(memchr(p, '"', last - p));
+    if (p == nullptr) {
+        return false;
+    }
+    frame.event.data   = name;
+    frame.event.length = p - name;
+    p++;
+
+    // optional argument after the name, "null" when there is no data
+    while (p < last && (isSpace(*p) || *p == ',')) p++;
+    while (last > p && isSpace(*(last - 1))) last--;
+    if (last - p == 4 && memcmp(p, "null", 4) == 0) {
+        return false;
+    }
+    frame.payload.data   = p;
+    frame.payload.length = last - p;
+    return true;
+}
+
+void SteerMessage::Set(double steering_angle, double throttle) {
+    static const char head[] = "42[\"steer\",{\"steering_angle\":";
+    static const char mid[]  = ",\"throttle\":";
+
+    char *p = buf;
+    memcpy(p, head, sizeof(head) - 1);
+    p = formatDouble(p + sizeof(head) - 1, steering_angle);
+    memcpy(p, mid, sizeof(mid) - 1);
+    p = formatDouble(p + sizeof(mid) - 1, throttle);
+    *p++ = '}';
+    *p++ = ']';
+    length = p - buf;
+}
@@ -0,0 +1,51 @@
+#ifndef SOCKETIO_H
+#define SOCKETIO_H
+
+#include <cstddef>
+#include <cstring>
+
+/*
+* Non-owning view into a buffer, used to avoid copying frame content.
+*/
+struct StrView {
+  const char *data;
+  size_t      length;
+
+  bool empty() const { return length == 0; }
+
+  bool equals(const char *s) const {
+    size_t n = strlen(s);
+    return n == length && memcmp(data, s, n) == 0;
+  }
+};
+
+/*
+* A decoded SocketIO event frame, all views point into the receive buffer.
+*/
+struct SioFrame {
+  StrView json;     // whole event array "[...]", what hasData() used to return
+  StrView event;    // event name without quotes, e.g. telemetry
+  StrView payload;  // event argument following the name, e.g. {...}
+};
+
+/*
+* Decode a "42[...]" SocketIO event frame in place without copying.
+* Returns false if the frame carries no JSON data, i.e. the event argument is
+* null (manual driving) or the frame is not a well-formed event array.
+*/
+bool decodeFrame(const char *data, size_t length, SioFrame &frame);
+
+/*
+* Fixed-capacity 42["steer",{"steering_angle":..,"throttle":..}] reply built
+* on the stack. The constant skeleton is copied and both numbers are
+* formatted in place, the text matches what json::dump() produced before.
+*/
+struct SteerMessage {
+  char   buf[128];
+  size_t length;
+
+  void Set(double steering_angle, double throttle);
+  const char *data() const { return buf; }
+};
+
+#endif /* SOCKETIO_H */
@@ -0,0 +1,50 @@
+#ifndef SPEED_CONTROL_H
+#define SPEED_CONTROL_H
+
+#include <algorithm>
+#include <cmath>
+#include <ostream>
+#include "PID.h"
+
+/*
+* Throttle from a speed PID instead of the fixed 0.5 - 0.3 * |d_angle| law.
+* Cascaded with steering: the speed setpoint drops linearly with the
+* steering demand of the same step, down to (1 - steer_drop) * target_speed
+* at full lock, so the car slows into turns and runs at the target on
+* straights. Throttle is limited to [-1, 1] with conditional integration
+* so the long acceleration from standstill does not wind up the integral.
+*/
+struct SpeedControl {
+  PID               pid_throttle;  // on speed - setpoint in mph
+  double            target_speed;  // mph, also the speed reference of the twiddle cost
+  double            steer_drop;    // fraction of target_speed shed at full steering
+  PidLimits<double> limits;
+
+  SpeedControl() : target_speed(40), steer_drop(0.15) {
+    pid_throttle.Init(0.2, 0.005, 0.0);
+    limits.windup = WINDUP_CONDITIONAL;
+  }
+
+  double Setpoint(double steer_value) const {
+    return target_speed * (1 - steer_drop * std::min(std::fabs(steer_value), 1.0));
+  }
+
+  double Throttle(double speed, double steer_value) {
+    return pid_throttle.UpdateLimited(speed - Setpoint(steer_value), 1, limits);
+  }
+
+  void Print(std::ostream &os) const {
+    os << "[Info] Speed control to " << target_speed << " mph, shedding "
+       << steer_drop * 100 << "% at full steering, tp: " << pid_throttle.Kp
+       << ", ti: " << pid_throttle.Ki << ", td: " << pid_throttle.Kd << std::endl;
+  }
+
+  /*
+  * Clear the errors, keep the gains.
+  */
+  void Reset() {
+    pid_throttle.Init(pid_throttle.Kp, pid_throttle.Ki, pid_throttle.Kd);
+  }
+};
+
+#endif /* SPEED_CONTROL_H */
@@ -0,0 +1,259 @@
+#include "strconv.h"
+#include <cerrno>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <locale.h>
+#ifdef __APPLE__
+#include <xlocale.h>
+#endif
+
+// Powers of ten that are exactly representable as double.
+static const double kPow10[] = {
+    1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+static const uint64_t kMaxExactMantissa = uint64_t(1) << 53;
+
+// Slow path for the numbers the fast path cannot round exactly, strtod_l with
+// the "C" locale is correctly rounded and ignores the user locale.
+static PARSE_STATUS parseDoubleSlow(const char *begin, const char *end, double &value) {
+    static locale_t c_locale = newlocale(LC_NUMERIC_MASK, "C", (locale_t)0);
+
+    char buf[128];
+    size_t len = end - begin;
+    if (len >= sizeof(buf)) {
+        return PARSE_INVALID;
+    }
+    memcpy(buf, begin, len);
+    buf[len] = '\0';
+
+    char *stop;
+    errno = 0;
+    double v = strtod_l(buf, &stop, c_locale);
+    if (errno == ERANGE && (v == 0 || std::isinf(v))) {
+        return PARSE_RANGE;
+    }
+    value = v;
+    return PARSE_OK;
+}
+
+PARSE_STATUS parseDouble(const char *begin, const char *end, double &value) {
+    if (begin == end) {
+        return PARSE_EMPTY;
+    }
+
+    const char *p = begin;
+    bool negative = false;
+    if (*p == '-' || *p == '+') {
+        negative = (*p == '-');
+        p++;
+    }
+
+    // mantissa, at most 19 significant digits fit into 64 bits
+    uint64_t mantissa = 0;
+    int      n_digits = 0;
+    int      exp10    = 0;
+    bool     any      = false;
+    bool     exact    = true;
+
+    for (; p < end && *p >= '0' && *p <= '9'; p++) {
+        any = true;
+        if (mantissa == 0 && *p == '0') continue;
+        if (n_digits < 19) {
+            mantissa = mantissa * 10 + (*p - '0');
+            n_digits++;
+        } else {
+            exp10++;
+            exact = false;
+        }
+    }
+    if (p < end && *p == '.') {
+        p++;
+        for (; p < end && *p >= '0' && *p <= '9'; p++) {
+            any = true;
+            if (mantissa == 0 && *p == '0') {
+                exp10--;
+                continue;
+            }
+            if (n_digits < 19) {
+                mantissa = mantissa * 10 + (*p - '0');
+                n_digits++;
+                exp10--;
+            } else {
+                exact = false;
+            }
+        }
+    }
+    if (!any) {
+        return PARSE_INVALID;
+    }
+
+    if (p < end && (*p == 'e' || *p == 'E')) {
+        p++;
+        bool exp_negative = false;
+        if (p < end && (*p == '-' || *p == '+')) {
+            exp_negative = (*p == '-');
+            p++;
+        }
+        if (p == end) {
+            return PARSE_INVALID;
+        }
+        int e = 0;
+        for (; p < end && *p >= '0' && *p <= '9'; p++) {
+            if (e < 100000) e = e * 10 + (*p - '0');
+        }
+        exp10 += exp_negative ? -e : e;
+    }
+    if (p != end) {
+        return PARSE_INVALID;
+    }
+
+    if (mantissa == 0) {
+        value = negative ? -0.0 : 0.0;
+        return PARSE_OK;
+    }
+
+    // Clinger's fast path, both operands are exact so the single
+    // multiplication or division is correctly rounded.
+    if (exact && mantissa <= kMaxExactMantissa && exp10 >= -22 && exp10 <= 22) {
+        double v = static_cast<double>(mantissa);
+        v = exp10 < 0 ? v / kPow10[-exp10] : v * kPow10[exp10];
+        value = negative ? -v : v;
+        return PARSE_OK;
+    }
+
+    return parseDoubleSlow(begin, end, value);
+}
+
+// Exact product a * b = p + err, Dekker's algorithm unless a fused
+// multiply-add is as fast as a multiplication.
+static inline void twoProduct(double a, double b, double &p, double &err) {
+    p = a * b;
+#ifdef FP_FAST_FMA
+    err = std::fma(a, b, -p);
+#else
+    const double split = 134217729.0; // 2^27 + 1
+    double ca = split * a;
+    double a_hi = ca - (ca - a);
+    double a_lo = a - a_hi;
+    double cb = split * b;
+    double b_hi = cb - (cb - b);
+    double b_lo = b - b_hi;
+    err = ((a_hi * b_hi - p) + a_hi * b_lo + a_lo * b_hi) + a_lo * b_lo;
+#endif
+}
+
+// Exponent notation and anything else the fast path does not cover, same
+// steps as nlohmann::json numtostr.
+static char *formatDoubleSlow(char *out, double v) {
+    char buf[kFormatDoubleMax];
+    int n = snprintf(buf, sizeof(buf), "%.15g", v);
+    if (n <= 0 || n >= kFormatDoubleMax - 2) {
+        n = 0;
+    }
+
+    const struct lconv *loc = localeconv();
+    const char decimal_point = (loc && loc->decimal_point) ? loc->decimal_point[0] : '.';
+
+    bool int_like = true;
+    for (int i = 0; i < n; i++) {
+        char c = buf[i];
+        if (c == decimal_point) c = '.';
+        int_like = int_like && c != '.' && c != 'e' && c != 'E';
+        *out++ = c;
+    }
+    if (int_like) {
+        *out++ = '.';
+        *out++ = '0';
+    }
+    return out;
+}
+
+char *formatDouble(char *out, double v) {
+    if (!std::isfinite(v)) {
+        memcpy(out, "null", 4);
+        return out + 4;
+    }
+    if (std::signbit(v)) {
+        *out++ = '-';
+        v = -v;
+    }
+    if (v == 0) {
+        memcpy(out, "0.0", 3);
+        return out + 3;
+    }
+    // %.15g falls back to exponent notation outside [1e-4, 1e15)
+    if (v < 1e-4 || v >= 1e15) {
+        return formatDoubleSlow(out, v);
+    }
+
+    // decimal exponent guess, corrected below once the digits are rounded
+    int e = 0;
+    if (v >= 1) {
+        while (e < 14 && v >= kPow10[e + 1]) e++;
+    } else {
+        e = -1;
+        while (e > -4 && v * kPow10[-e] < 1) e--;
+    }
+
+    // 15 significant digits, rounded half to even on the exact product
+    const uint64_t lo = 100000000000000ULL; // 10^14
+    const uint64_t hi = lo * 10;
+    uint64_t digits = 0;
+    for (int attempt = 0; attempt < 3; attempt++) {
+        int scale = 14 - e;
+        if (scale < 0 || scale > 22) {
+            return formatDoubleSlow(out, v);
+        }
+        double p, err;
+        twoProduct(v, kPow10[scale], p, err);
+        double r = std::floor(p);
+        double t = ((p - r) - 0.5) + err;
+        digits = static_cast<uint64_t>(r);
+        if (t > 0 || (t == 0 && (digits & 1))) {
+            digits++;
+        }
+        if (digits >= hi) {
+            e++;
+        } else if (digits < lo) {
+            e--;
+        } else {
+            break;
+        }
+    }
+    if (digits < lo || digits >= hi || e < -4 || e > 14) {
+        return formatDoubleSlow(out, v);
+    }
+
+    char d[15];
+    for (int i = 14; i >= 0; i--) {
+        d[i] = '0' + static_cast<char>(digits % 10);
+        digits /= 10;
+    }
+    int n_digits = 15;
+    while (n_digits > 1 && d[n_digits - 1] == '0') n_digits--;
+
+    if (e >= 0) {
+        int n_int = e + 1;
+        memcpy(out, d, n_int);
+        out += n_int;
+        *out++ = '.';
+        if (n_digits > n_int) {
+            memcpy(out, d + n_int, n_digits - n_int);
+            out += n_digits - n_int;
+        } else {
+            *out++ = '0';
+        }
+    } else {
+        *out++ = '0';
+        *out++ = '.';
+        for (int i = -1; i > e; i--) *out++ = '0';
+        memcpy(out, d, n_digits);
+        out += n_digits;
+    }
+    return out;
+}
@@ -0,0 +1,29 @@
+#ifndef STRCONV_H
+#define STRCONV_H
+
+enum PARSE_STATUS
+{
+    PARSE_OK = 0,
+    PARSE_EMPTY,     // no characters to parse
+    PARSE_INVALID,   // not a decimal number or trailing characters
+    PARSE_RANGE      // overflow or underflow
+};
+
+/*
+* Locale-independent, correctly rounded conversion of the decimal number that
+* spans exactly [begin, end) to double. The buffer needs no terminating null
+* and no exception is thrown, value is only written on PARSE_OK.
+*/
+PARSE_STATUS parseDouble(const char *begin, const char *end, double &value);
+
+/*
+* Write v the way nlohmann::json dump() does ("%.15g", ".0" appended to
+* integral values, null for inf/nan) so replies stay byte-compatible.
+* Needs no heap, out must hold kFormatDoubleMax characters. Returns the
+* end of the written text, no terminating null is added.
+*/
+static const int kFormatDoubleMax = 32;
+
+char *formatDouble(char *out, double v);
+
+#endif /* STRCONV_H */
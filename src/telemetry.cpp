@@ -0,0 +1,136 @@
+#include "telemetry.h"
+#include <string>
+#include "json.hpp"
+#include "strconv.h"
+
+using json = nlohmann::json;
+
+enum FIELD
+{
+    FIELD_CTE   = 1 << 0,
+    FIELD_SPEED = 1 << 1,
+    FIELD_ANGLE = 1 << 2,
+    FIELD_ALL   = FIELD_CTE | FIELD_SPEED | FIELD_ANGLE
+};
+
+static inline const char *skipSpace(const char *p, const char *end) {
+    while (p < end && (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n')) p++;
+    return p;
+}
+
+bool extractTelemetry(const SioFrame &frame, Telemetry &tel) {
+    if (!frame.event.equals("telemetry")) {
+        return false;
+    }
+
+    const char *p   = frame.payload.data;
+    const char *end = p + frame.payload.length;
+    if (p == end || *p != '{') {
+        return false;
+    }
+    p++;
+
+    int found = 0;
+    for (;;) {
+        p = skipSpace(p, end);
+        if (p == end) return false;
+        if (*p == '}') break;
+
+        // key
+        if (*p != '"') return false;
+        const char *key = ++p;
+        while (p < end && *p != '"' && *p != '\\') p++;
+        if (p == end || *p == '\\') return false;
+        size_t key_len = p - key;
+        p = skipSpace(p + 1, end);
+        if (p == end || *p != ':') return false;
+        p = skipSpace(p + 1, end);
+        if (p == end) return false;
+
+        // value, either a quoted string or a bare scalar
+        const char *val;
+        const char *val_end;
+        if (*p == '"') {
+            val = ++p;
+            while (p < end && *p != '"' && *p != '\\') p++;
+            if (p == end || *p == '\\') return false;
+            val_end = p++;
+        } else if (*p == '{' || *p == '[') {
+            return false;
+        } else {
+            val = p;
+            while (p < end && *p != ',' && *p != '}' && *p != ' ') p++;
+            val_end = p;
+        }
+
+        int field = 0;
+        double *dst = nullptr;
+        if (key_len == 3 && memcmp(key, "cte", 3) == 0) {
+            field = FIELD_CTE;
+            dst = &tel.cte;
+        } else if (key_len == 5 && memcmp(key, "speed", 5) == 0) {
+            field = FIELD_SPEED;
+            dst = &tel.speed;
+        } else if (key_len == 14 && memcmp(key, "steering_angle", 14) == 0) {
+            field = FIELD_ANGLE;
+            dst = &tel.steering_angle;
+        }
+        if (dst != nullptr) {
+            if (parseDouble(val, val_end, *dst) != PARSE_OK) return false;
+            found |= field;
+        }
+
+        p = skipSpace(p, end);
+        if (p == end) return false;
+        if (*p == ',') {
+            p++;
+        } else if (*p != '}') {
+            return false;
+        }
+    }
+    return found == FIELD_ALL;
+}
+
+// The simulator sends numbers as strings, accept plain numbers as well.
+// Strings go through parseDouble like on the fast path, anything else that
+// is not a number (a missing key, null, objects, out of range) fails.
+static bool getNumber(const json &obj, const char *key, double &value) {
+    auto it = obj.find(key);
+    if (it == obj.end()) {
+        return false;
+    }
+    const json &j = *it;
+    if (j.is_string()) {
+        const std::string &s = j.get_ref<const std::string &>();
+        return parseDouble(s.data(), s.data() + s.size(), value) == PARSE_OK;
+    }
+    if (!j.is_number()) {
+        return false;
+    }
+    value = j.get<double>();
+    return true;
+}
+
+bool parseTelemetryJson(const SioFrame &frame, Telemetry &tel) {
+    // a malformed frame from one simulator must not take the process down,
+    // it is answered like any other frame that is not telemetry
+    try {
+        auto j = json::parse(frame.json.data, frame.json.data + frame.json.length);
+        if (!j.is_array() || j.size() < 2 || !j[0].is_string() || !j[1].is_object() ||
+            j[0].get_ref<const std::string &>() != "telemetry") {
+            return false;
+        }
+        // j[1] is the data JSON object
+        const json &data = j[1];
+        Telemetry t;
+        if (!getNumber(data, "cte", t.cte) ||
+            !getNumber(data, "speed", t.speed) ||
+            !getNumber(data, "steering_angle", t.steering_angle)) {
+            return false;
+        }
+        tel = t;
+        return true;
+    } catch (const std::exception &) {
+        return false;
+    }
+}
@@ -0,0 +1,32 @@
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include "socketio.h"
+
+/*
+* Fields of a "telemetry" event used by the controller.
+*/
+struct Telemetry {
+  double cte;
+  double speed;
+  double steering_angle;
+};
+
+/*
+* Schema-specific extractor, reads the event name and cte, speed and
+* steering_angle in a single forward pass over the frame without building a
+* JSON DOM or temporary strings.
+* Returns false for any other event or for payloads it does not recognize
+* (missing fields, nested values, escapes), these go to parseTelemetryJson().
+*/
+bool extractTelemetry(const SioFrame &frame, Telemetry &tel);
+
+/*
+* Generic path through nlohmann::json, kept for unknown frames and for
+* validating the extractor. Returns false if the event is not telemetry or
+* the frame is malformed (bad JSON, a field missing or not a number), never
+* throws.
+*/
+bool parseTelemetryJson(const SioFrame &frame, Telemetry &tel);
+
+#endif /* TELEMETRY_H */
@@ -0,0 +1,90 @@
+#include "thread_pool.h"
+
+ThreadPool::ThreadPool(int n_threads) : next_queue(0), pending(0), stop(false) {
+    if (n_threads <= 0) {
+        n_threads = std::thread::hardware_concurrency();
+        if (n_threads <= 0) n_threads = 1;
+    }
+    for (int i = 0; i < n_threads; i++) {
+        queues.emplace_back(new Queue());
+    }
+    for (int i = 0; i < n_threads; i++) {
+        workers.emplace_back(&ThreadPool::WorkerLoop, this, i);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stop = true;
+    }
+    work_cv.notify_all();
+    for (auto &w : workers) {
+        w.join();
+    }
+}
+
+void ThreadPool::Submit(std::function<void()> task) {
+    pending.fetch_add(1);
+    Queue &q = *queues[next_queue.fetch_add(1) % queues.size()];
+    {
+        std::lock_guard<std::mutex> lock(q.mutex);
+        q.tasks.push_back(std::move(task));
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+    }
+    work_cv.notify_one();
+}
+
+void ThreadPool::Wait() {
+    std::unique_lock<std::mutex> lock(mutex);
+    done_cv.wait(lock, [this] { return pending.load() == 0; });
+}
+
+bool ThreadPool::TryRun(size_t self) {
+    std::function<void()> task;
+    // own queue first, newest task
+    {
+        Queue &q = *queues[self];
+        std::lock_guard<std::mutex> lock(q.mutex);
+        if (!q.tasks.empty()) {
+            task = std::move(q.tasks.back());
+            q.tasks.pop_back();
+        }
+    }
+    // then steal the oldest task of another worker
+    for (size_t k = 1; !task && k < queues.size(); k++) {
+        Queue &q = *queues[(self + k) % queues.size()];
+        std::lock_guard<std::mutex> lock(q.mutex);
+        if (!q.tasks.empty()) {
+            task = std::move(q.tasks.front());
+            q.tasks.pop_front();
+        }
+    }
+    if (!task) {
+        return false;
+    }
+
+    task();
+    if (pending.fetch_sub(1) == 1) {
+        std::lock_guard<std::mutex> lock(mutex);
+        done_cv.notify_all();
+    }
+    return true;
+}
+
+void ThreadPool::WorkerLoop(size_t self) {
+    for (;;) {
+        if (TryRun(self)) {
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(mutex);
+        if (stop) {
+            return;
+        }
+        // pending counts running tasks too, so this may wake up for nothing,
+        // the timeout covers a notify that raced with going to sleep
+        work_cv.wait_for(lock, std::chrono::milliseconds(1));
+    }
+}
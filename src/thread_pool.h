@@ -0,0 +1,53 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*
+* Work-stealing thread pool. Every worker has its own task deque, takes work
+* from its back and steals from the front of the others when it runs dry.
+*/
+class ThreadPool {
+public:
+  /*
+  * n_threads <= 0 sizes the pool to the machine.
+  */
+  explicit ThreadPool(int n_threads = 0);
+  ~ThreadPool();
+
+  int Size() const { return workers.size(); }
+
+  void Submit(std::function<void()> task);
+
+  /*
+  * Block until every submitted task has finished.
+  */
+  void Wait();
+
+private:
+  struct Queue {
+    std::mutex                        mutex;
+    std::deque<std::function<void()>> tasks;
+  };
+
+  std::vector<std::thread>            workers;
+  std::vector<std::unique_ptr<Queue>> queues;
+  std::atomic<size_t>                 next_queue;
+  std::atomic<size_t>                 pending;     // submitted, not finished
+  std::mutex                          mutex;       // guards sleeping and stop
+  std::condition_variable             work_cv;
+  std::condition_variable             done_cv;
+  bool                                stop;
+
+  bool TryRun(size_t self);
+  void WorkerLoop(size_t self);
+};
+
+#endif /* THREAD_POOL_H */
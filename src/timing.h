@@ -0,0 +1,29 @@
+#ifndef TIMING_H
+#define TIMING_H
+
+#include <chrono>
+#include <cstdint>
+
+/*
+* Stages of handling one telemetry frame, in the order they run.
+*/
+enum STAGE
+{
+    STAGE_DECODE = 0,   // SocketIO frame decode
+    STAGE_PARSE,        // telemetry extraction
+    STAGE_COST,         // SSE accumulation and twiddle
+    STAGE_CONTROL,      // PID update and actuation values
+    STAGE_REPLY,        // steer message serialization
+    STAGE_SEND,         // ws.send
+    STAGE_COUNT
+};
+
+/*
+* Monotonic timestamp in nanoseconds.
+*/
+inline uint64_t nowNs() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+#endif /* TIMING_H */
@@ -0,0 +1,216 @@
+// Offline twiddle tuning against the headless simulator.
+//
+//   ./pid_tune [--kp=.. --ki=.. --kd=..] [--dp=.. --di=.. --dd=..] [--n_step=800]
+//   ./pid_tune --eval [--kp=.. --ki=.. --kd=..]
+//   ./pid_tune --parallel [--threads=N] [--scaling] ...
+//   ./pid_tune --speed=40 [--tp=.. --ti=.. --td=..] [--speed_drop=..] ...
+//   ./pid_tune --schedule_out=gains.bin [--bands=4 --band_min=25 --band_max=55]
+//   ./pid_tune --d_filter=biquad [--d_cutoff=0.1] [--d_measurement] [--cte_noise=0.1] ...
+//   ./pid_tune --velocity ...
+//
+// Runs the same TwiddleTuner::Twiddle search as ./pid -t, with every episode played
+// on the kinematic simulator instead of the Unity one. --parallel evaluates
+// the probes of all gains at once on a thread pool, --scaling repeats that
+// search with 1 to N threads and reports the speedup. --speed drives the
+// throttle with the cascaded speed controller while the steering is tuned.
+// --schedule_out tunes the steering once per speed band and writes the
+// gains as a schedule for ./pid --schedule. --d_filter and --d_measurement
+// take the steering derivative like ./pid does, --cte_noise adds sensor
+// noise to the reported cte to compare them. --velocity tunes the
+// incremental form of the steering controller.
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include "args.hxx"
+#include "PID.h"
+#include "gain_schedule.h"
+#include "parallel_twiddle.h"
+#include "sim.h"
+#include "twiddle.h"
+
+int main(int argc, char* argv[])
+{
+    args::ArgumentParser parser("tunes PID gains with twiddle on a headless kinematic simulator");
+    args::HelpFlag help(parser, "help", "Display help menu", {'h', "help"});
+    args::Group gain_grp(parser, "kp, ki, kd need to coexist", args::Group::Validators::AllOrNone);
+    args::ValueFlag<float>  kp(gain_grp, "float", "set/initialize proportional gain", {"kp"});
+    args::ValueFlag<float>  ki(gain_grp, "float", "set/initialize integral gain", {"ki"});
+    args::ValueFlag<float>  kd(gain_grp, "float", "set/initialize derivative gain", {"kd"});
+    args::Group dgain_grp(parser, "dp, di, dd need to coexist", args::Group::Validators::AllOrNone);
+    args::ValueFlag<float>  dp(dgain_grp, "float", "kp max tunable range", {"dp"});
+    args::ValueFlag<float>  di(dgain_grp, "float", "ki max tunable range", {"di"});
+    args::ValueFlag<float>  dd(dgain_grp, "float", "kd max tunable range", {"dd"});
+    args::ValueFlag<int>    n_step(parser, "int", "set number of step per twiddle iteration, default 800", {"n_step"});
+    args::ValueFlag<float>  tol(parser, "float", "stop when dp + di + dd falls below, default 0.005", {"tol"});
+    args::Flag              parallel(parser, "parallel", "evaluate all twiddle probes of a round in parallel", {"parallel"});
+    args::ValueFlag<int>    threads(parser, "int", "worker threads for --parallel, default all cores", {"threads"});
+    args::Flag              scaling(parser, "scaling", "run --parallel with 1 to --threads workers and report speedup", {"scaling"});
+    args::ValueFlag<double> target_speed(parser, "float", "drive at this speed in mph with a throttle PID instead of the fixed throttle law", {"speed"});
+    args::Group tgain_grp(parser, "tp, ti, td need to coexist", args::Group::Validators::AllOrNone);
+    args::ValueFlag<float>  tp(tgain_grp, "float", "throttle proportional gain, default 0.2", {"tp"});
+    args::ValueFlag<float>  ti(tgain_grp, "float", "throttle integral gain, default 0.005", {"ti"});
+    args::ValueFlag<float>  td(tgain_grp, "float", "throttle derivative gain, default 0", {"td"});
+    args::ValueFlag<double> speed_drop(parser, "float", "fraction of the target speed shed at full steering, default 0.15", {"speed_drop"});
+    args::ValueFlag<std::string> schedule_out(parser, "file", "tune steering per speed band with the speed controller and write a gain schedule", {"schedule_out"});
+    args::ValueFlag<int>    bands(parser, "int", "number of speed bands for --schedule_out, default 4", {"bands"});
+    args::ValueFlag<float>  band_min(parser, "float", "speed of the first band in mph, default 25", {"band_min"});
+    args::ValueFlag<float>  band_max(parser, "float", "speed of the last band in mph, default 55", {"band_max"});
+    args::ValueFlag<std::string> d_filter(parser, "type", "low-pass on the steering derivative: none, lowpass or biquad", {"d_filter"});
+    args::ValueFlag<double> d_cutoff(parser, "float", "derivative low-pass cutoff as a fraction of the update rate, default 0.1", {"d_cutoff"});
+    args::Flag              d_measurement(parser, "d_measurement", "take the steering derivative on the measurement", {"d_measurement"});
+    args::Flag              velocity(parser, "velocity", "steer with the velocity (incremental) form of the PID", {"velocity"});
+    args::ValueFlag<double> cte_noise(parser, "float", "std deviation in m of noise added to the simulated cte, default 0", {"cte_noise"});
+    args::Flag              eval(parser, "eval", "only run one episode with the given gains and print its SSE", {"eval"});
+
+    try
+    {
+        parser.ParseCLI(argc, argv);
+    }
+    catch (args::Help)
+    {
+        std::cout << parser;
+        return 0;
+    }
+    catch (args::ParseError e)
+    {
+        std::cerr << e.what() << std::endl;
+        std::cerr << parser;
+        return 1;
+    }
+    catch (args::ValidationError e)
+    {
+        std::cerr << e.what() << std::endl;
+        std::cerr << parser;
+        return 1;
+    }
+
+    PID pid_steer;
+    TwiddleTuner tuner;
+    tuner.SetEnabled(true);
+    if (n_step) tuner.SetEndStep(args::get(n_step));
+    if (tol) tuner.SetTolerance(args::get(tol));
+    if (kp && ki && kd) {
+        tuner.SetGains(args::get(kp), args::get(ki), args::get(kd));
+    } else {
+        tuner.SetGains(0.15, 0.001, 0.6);
+    }
+    if (dp && di && dd) {
+        tuner.SetSteps(args::get(dp), args::get(di), args::get(dd));
+    }
+    const TwiddleProgress start = tuner.Progress();
+    if (d_filter || d_measurement) {
+        std::string type = d_filter ? args::get(d_filter) : "none";
+        double cutoff = d_cutoff ? args::get(d_cutoff) : 0.1;
+        DFILTER t;
+        if (!parseDFilter(type, t)) {
+            std::cerr << "[Error] d_filter must be none, lowpass or biquad." << std::endl;
+            return 1;
+        }
+        if (!DerivFilter<double>::IsValidCutoff(cutoff)) {
+            std::cerr << "[Error] d_cutoff must be between 0 and 0.5." << std::endl;
+            return 1;
+        }
+        pid_steer.SetDerivFilter(t, cutoff, d_measurement);
+        std::cout << "[Info] Steering derivative filter: " << type << ", cutoff " << cutoff
+                  << (d_measurement ? ", on measurement" : "") << std::endl;
+    }
+    if (velocity) {
+        pid_steer.SetVelocity(true);
+        std::cout << "[Info] Velocity form PID" << std::endl;
+    }
+    pid_steer.Init(start.gain[0], start.gain[1], start.gain[2]);
+
+    SpeedControl speed_control;
+    SpeedControl *speed = nullptr;
+    if (target_speed || tp) {
+        SpeedControl &sc = speed_control;
+        if (target_speed) sc.target_speed = args::get(target_speed);
+        if (speed_drop) sc.steer_drop = args::get(speed_drop);
+        if (tp && ti && td) {
+            sc.pid_throttle.Init(args::get(tp), args::get(ti), args::get(td));
+        }
+        speed = &speed_control;
+        sc.Print(std::cout);
+    }
+
+    Track track = Track::LakeLike();
+    VehicleSim sim(track);
+    if (cte_noise) sim.cte_noise = args::get(cte_noise);
+
+    auto t0 = std::chrono::steady_clock::now();
+    if (eval) {
+        double SSE = runEpisode(sim, pid_steer, tuner.EndStep(), 1e300, speed);
+        double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t0).count();
+        std::printf("SSE: %.1f, kp: %g, ki: %g, kd: %g (%.1f us)\n",
+                    SSE, pid_steer.Kp, pid_steer.Ki, pid_steer.Kd, us);
+        return 0;
+    }
+
+    if (schedule_out) {
+        // one parallel twiddle per band, the speed controller holds the car
+        // at the band speed while the steering gains are tuned for it
+        int   n_bands = bands ? std::max(1, args::get(bands)) : 4;
+        float lo      = band_min ? args::get(band_min) : 25;
+        float hi      = band_max ? args::get(band_max) : 55;
+        float step    = n_bands > 1 ? (hi - lo) / (n_bands - 1) : 0;
+        if (n_bands > 1024 || (n_bands > 1 && !(step > 0))) {
+            std::cerr << "[Error] bands must be at most 1024 and band_max above band_min" << std::endl;
+            return 1;
+        }
+        ThreadPool pool(threads ? args::get(threads) : 0);
+        std::vector<float> band_gains;
+        for (int b = 0; b < n_bands; b++) {
+            SpeedControl band_speed = speed_control;
+            band_speed.target_speed = lo + b * step;
+            TwiddleResult res = parallelTwiddle(sim, start.gain, start.d_gain,
+                                                tuner.EndStep(), tuner.Tolerance(),
+                                                pool, &band_speed, pid_steer);
+            std::printf("[Info] band %d, %.1f mph: Best SSE: %.1f, kp: %g, ki: %g, kd: %g\n",
+                        b, band_speed.target_speed, res.best_sse, res.gain[0], res.gain[1], res.gain[2]);
+            band_gains.insert(band_gains.end(), res.gain, res.gain + 3);
+        }
+        GainSchedule table;
+        if (!table.SetSpeedBands(lo, step, band_gains)) {
+            std::cerr << "[Error] Invalid speed bands" << std::endl;
+            return 1;
+        }
+        if (!table.Save(args::get(schedule_out).c_str())) {
+            std::cerr << "[Error] Failed to write " << args::get(schedule_out) << std::endl;
+            return 1;
+        }
+        std::printf("[Info] Gain schedule with %d speed bands written to %s\n",
+                    n_bands, args::get(schedule_out).c_str());
+        return 0;
+    }
+
+    if (parallel || scaling) {
+        int max_threads = threads ? args::get(threads) : ThreadPool().Size();
+        int min_threads = scaling ? 1 : max_threads;
+        double base_sec = 0;
+        for (int n = min_threads; n <= max_threads; n++) {
+            ThreadPool pool(n);
+            auto t1 = std::chrono::steady_clock::now();
+            TwiddleResult res = parallelTwiddle(sim, start.gain, start.d_gain,
+                                                tuner.EndStep(), tuner.Tolerance(), pool, speed,
+                                                pid_steer);
+            double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - t1).count();
+            if (n == min_threads) base_sec = sec;
+            std::printf("[Info] threads: %2d, Best SSE: %.1f, kp: %g, ki: %g, kd: %g, "
+                        "%d rounds, %d episodes in %.3f s, speedup %.2fx\n",
+                        n, res.best_sse, res.gain[0], res.gain[1], res.gain[2],
+                        res.rounds, res.episodes, sec, base_sec / sec);
+        }
+        return 0;
+    }
+
+    int episodes = 0;
+    for (;;) {
+        double SSE = runEpisode(sim, pid_steer, tuner.EndStep(), tuner.BestSse(), speed);
+        episodes++;
+        if (tuner.Twiddle(SSE, pid_steer)) break;
+    }
+    double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    std::printf("[Info] %d episodes in %.3f s (%.1f us/episode)\n", episodes, sec, sec * 1e6 / episodes);
+    return 0;
+}
@@ -0,0 +1,140 @@
+#include "twiddle.h"
+#include <iostream>
+
+using namespace std;
+
+enum STATE
+{
+    ASCENT = 0,
+    DESCENT
+};
+
+TwiddleTuner::TwiddleTuner() {
+    is_twiddle        = false;
+    is_twiddle_init   = false;
+    twiddle_tol       = 0.005;
+    twiddle_endstep   = 800;
+    twiddle_cnt       = 0;
+    twiddle_best_sse  = 9999999;
+
+    gain[0] = 0.0f;
+    gain[1] = 0.0f;
+    gain[2] = 0.0f;
+ 
+    d_gain[0] = 1.0f;
+    d_gain[1] = 1.0f;
+    d_gain[2] = 1.0f;
+    
+    best_gain[0] = 0.0f;
+    best_gain[1] = 0.0f;
+    best_gain[2] = 0.0f;
+
+    gain_idx = 0;   //0: P, 1: I, 2: D
+	state = ASCENT;
+}
+
+void TwiddleTuner::SetGains(float kp, float ki, float kd) {
+    gain[0] = kp;
+    gain[1] = ki;
+    gain[2] = kd;
+}
+
+void TwiddleTuner::SetSteps(float dp, float di, float dd) {
+    d_gain[0] = dp;
+    d_gain[1] = di;
+    d_gain[2] = dd;
+}
+
+TwiddleProgress TwiddleTuner::Progress() const {
+    TwiddleProgress p;
+    p.iteration = twiddle_cnt;
+    p.gain_idx  = gain_idx;
+    p.state     = state;
+    p.best_sse  = twiddle_best_sse;
+    for (int k = 0; k < 3; k++) {
+        p.gain[k]      = gain[k];
+        p.d_gain[k]    = d_gain[k];
+        p.best_gain[k] = best_gain[k];
+    }
+    return p;
+}
+
+void TwiddleTuner::Load(PID *pids, size_t n) const {
+    for (size_t k = 0; k < n; k++) {
+        pids[k].Init(gain[0], gain[1], gain[2]);
+    }
+}
+
+int TwiddleTuner::Twiddle(double SSE, PID *pids, size_t n) {
+    
+    if (!is_twiddle_init) {
+        twiddle_best_sse = SSE;
+        best_gain[0]=gain[0];
+        best_gain[1]=gain[1];
+        best_gain[2]=gain[2];
+
+        gain[gain_idx] += d_gain[gain_idx];
+        Load(pids, n);
+        
+        state = ASCENT;
+        is_twiddle_init = true;
+        return 0;
+    }
+
+    // Exit twiddle if total of all delta is lower than tolerance
+    if (d_gain[0] + d_gain[1] + d_gain[2] < twiddle_tol) {
+        std::cout << "[Info] Twiddle Tuning Complete! Best SSE: "<< twiddle_best_sse
+            << ", kp: "  << best_gain[0] 
+            << ", ki: "  << best_gain[1]
+            << ", kd: "  << best_gain[2]
+            << std::endl;
+        return 1;
+    }
+
+	switch (state) {
+		case ASCENT:
+			if (SSE < twiddle_best_sse) {
+        		twiddle_best_sse = SSE;
+				best_gain[0]=gain[0];
+		        best_gain[1]=gain[1];
+        		best_gain[2]=gain[2];
+
+        		d_gain[gain_idx] *= 1.1;
+        		gain_idx = (gain_idx + 1) % 3;
+				gain[gain_idx] += d_gain[gain_idx];
+				Load(pids, n);
+
+				state = ASCENT;
+				twiddle_cnt++;
+    		} else {
+        		gain[gain_idx] -= 2 * d_gain[gain_idx];
+        		Load(pids, n);
+				state = DESCENT;
+    		}
+			break;
+
+		case DESCENT:
+		    if (SSE < twiddle_best_sse) {
+        		twiddle_best_sse = SSE;
+				best_gain[0]=gain[0];
+                best_gain[1]=gain[1];
+                best_gain[2]=gain[2];
+        		d_gain[gain_idx] *= 1.1;
+    		} else {
+        		gain[gain_idx] += d_gain[gain_idx];
+        		d_gain[gain_idx] *= 0.9;
+    		}
+    		gain_idx = (gain_idx + 1) % 3;
+			gain[gain_idx] += d_gain[gain_idx];
+        	Load(pids, n);
+			state = ASCENT;
+			twiddle_cnt++;
+			break;
+
+		default:
+			std::cout << "[ERROR] - BUG!!!" << std::endl;
+			break;
+	}
+    return 0;
+}
+
@@ -0,0 +1,75 @@
+#ifndef TWIDDLE_H
+#define TWIDDLE_H
+
+#include <cstddef>
+#include "PID.h"
+
+/*
+* Read-only view of a twiddle search, for logging and the command line tools.
+*/
+struct TwiddleProgress {
+  int       iteration;      // improving steps taken, 3 per round of all gains
+  int       gain_idx;       // gain being probed, 0: P, 1: I, 2: D
+  int       state;          // 0: probing +d_gain, 1: probing -d_gain
+  float     best_sse;
+  float     gain[3];        // current gain, convention Kp, Ki, Kd
+  float     d_gain[3];
+  float     best_gain[3];   // gain with best_sse
+};
+
+/*
+* Online twiddle search over Kp, Ki, Kd. Owns all of the search state and
+* only touches the controllers it drives between episodes, through Load(),
+* so none of it shares cache lines with the per-step controller state.
+* The starting point and settings are given before the first Twiddle().
+*/
+class TwiddleTuner {
+public:
+  /*
+  * Constructor
+  */
+  TwiddleTuner();
+
+  void SetEnabled(bool on) { is_twiddle = on; }
+  void SetEndStep(int n_steps) { twiddle_endstep = n_steps; }
+  void SetTolerance(float tol) { twiddle_tol = tol; }
+  void SetGains(float kp, float ki, float kd);
+  void SetSteps(float dp, float di, float dd);
+
+  bool  IsEnabled() const { return is_twiddle; }
+  int   EndStep() const { return twiddle_endstep; }
+  float Tolerance() const { return twiddle_tol; }
+  int   Iteration() const { return twiddle_cnt; }
+  float BestSse() const { return twiddle_best_sse; }
+  TwiddleProgress Progress() const;
+
+  /*
+  * Init the n controllers in pids with the current gain, clearing their
+  * errors.
+  */
+  void Load(PID *pids, size_t n) const;
+
+  /*
+  * Score the current gain with the SSE of the episode just run and load
+  * the next candidate into the n controllers in pids. Returns 1 when the
+  * search is complete, 0 to run another episode.
+  */
+  int Twiddle(double SSE, PID *pids, size_t n);
+
+  int Twiddle(double SSE, PID &pid) { return Twiddle(SSE, &pid, 1); }
+
+private:
+  bool      is_twiddle; 
+  bool      is_twiddle_init;
+  float     twiddle_tol;
+  int       twiddle_endstep;
+  int       twiddle_cnt;
+  float     twiddle_best_sse;
+  float     d_gain[3]; 
+  float     gain[3];        // current gain, convention Kp, Ki, Kd
+  float     best_gain[3];   // cached gain with best SSE
+  int       gain_idx;       // index to d_gain/gain, 0: P, 1: I, 2: D
+  int       state;
+};
+
+#endif /* TWIDDLE_H */